@@ -0,0 +1,650 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Size-class allocator for Click's own objects. Click's glue.cc implements
+ * operator new and delete on top of malloc() and free(); Makefile.uk
+ * compiles it with those renamed to click_malloc() and click_free(), so
+ * every String, Vector, HashTable node and Timer allocated by Click comes
+ * from here instead of from Unikraft's default allocator.
+ *
+ * Requests up to 2048 bytes are rounded up to one of a few size classes.
+ * Each thread keeps free blocks of every class in a private list and only
+ * takes the global lock of a class to move a batch of blocks in or out, or
+ * to carve a new slab. Larger requests get whole pages of their own.
+ *
+ * Slabs and large blocks are taken from the default allocator in pages,
+ * and a bitmap of those pages tells click_free() and click_realloc()
+ * whether a pointer is ours. Pointers that are not, e.g. from libc
+ * functions called by the glue, are passed on to free() and realloc()
+ * without reading anything around them.
+ *
+ * With LIBCLICK_MEMSTATS, every block also records the category of the
+ * thread allocating it (click_mem_cat), so the global "memory" handler can
+ * tell how much each category holds and held at most.
+ *
+ * Everything here works from zero-initialized static storage, since
+ * static constructors allocate before click_main() runs.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <click/config.h>
+#include <click/handler.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+
+#include <click_alloc.h>
+
+#include <uk/alloc.h>
+#include <uk/arch/limits.h>
+#include <uk/assert.h>
+#include <uk/essentials.h>
+
+#ifndef CONFIG_LIBCLICK_NTHREADS
+#define CONFIG_LIBCLICK_NTHREADS 1
+#endif
+
+#ifndef CONFIG_LIBCLICK_ALLOC_SLAB
+#define CONFIG_LIBCLICK_ALLOC_SLAB 65536
+#endif
+
+#define ALLOC_MAGIC	0xc11c0a11U
+#define ALLOC_LARGE	0xffU
+#define ALLOC_NCLASSES	14
+#if CONFIG_LIBCLICK_LOWMEM
+#define ALLOC_BATCH	8
+#else
+#define ALLOC_BATCH	32
+#endif
+#define ALLOC_SLAB	CONFIG_LIBCLICK_ALLOC_SLAB
+/* router threads, the main and control threads, and some slack */
+#define ALLOC_NCACHES	(CONFIG_LIBCLICK_NTHREADS + 4)
+#define ALLOC_PAGES(bytes)	(((bytes) + __PAGE_SIZE - 1) >> __PAGE_SHIFT)
+
+/* Page bitmap: a three-level radix tree over 48-bit addresses */
+#define PMAP_LEAF_BITS	18
+#define PMAP_MID_BITS	9
+#define PMAP_TOP_BITS	(48 - __PAGE_SHIFT - PMAP_MID_BITS - PMAP_LEAF_BITS)
+#define PMAP_LONG_BITS	(8 * sizeof(unsigned long))
+
+static const uint32_t class_size[ALLOC_NCLASSES] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+/* Precedes every block; keeps the user pointer 16-byte aligned */
+struct alloc_hdr {
+	uint32_t magic;
+	uint16_t cls;
+	uint16_t cat;		/* enum click_mem_cat */
+	size_t size;
+};
+
+struct alloc_free {
+	struct alloc_free *next;
+};
+
+struct alloc_cache {
+	struct alloc_free *head[ALLOC_NCLASSES];
+	uint32_t count[ALLOC_NCLASSES];
+	uint64_t allocs[ALLOC_NCLASSES];
+	uint64_t frees[ALLOC_NCLASSES];
+};
+
+struct alloc_class {
+	int lock;
+	struct alloc_free *head;
+	uint32_t count;
+	size_t slab_bytes;
+	/* by threads without a cache */
+	uint64_t allocs;
+	uint64_t frees;
+};
+
+static struct alloc_class classes[ALLOC_NCLASSES];
+static struct alloc_cache caches[ALLOC_NCACHES];
+static int ncaches;
+static __thread struct alloc_cache *my_cache;
+static __thread int my_cache_claimed;
+static uint64_t large_allocs, large_frees, large_bytes;
+
+/* Nodes are allocated once and never freed, so lookups take no lock */
+static void *pmap[1UL << PMAP_TOP_BITS];
+static int pmap_lock;
+
+#if CONFIG_LIBCLICK_MEMSTATS
+/* Bytes in use and their high-watermark per category, plus the total */
+struct mem_stat {
+	int64_t cur;
+	int64_t peak;
+};
+
+static struct mem_stat mem_stats[CLICK_MEM_NCATS + 1];
+__thread int click_mem_cat;
+
+static const char *const mem_cat_name[CLICK_MEM_NCATS] = {
+	"other", "elements", "tables", "packets", "netbufs"
+};
+
+static inline void
+mem_stat_add(struct mem_stat *m, long bytes)
+{
+	int64_t cur = __atomic_add_fetch(&m->cur, bytes, __ATOMIC_RELAXED);
+	int64_t peak = __atomic_load_n(&m->peak, __ATOMIC_RELAXED);
+
+	while (cur > peak
+	       && !__atomic_compare_exchange_n(&m->peak, &peak, cur, true,
+					       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+void
+click_mem_add(int cat, long bytes)
+{
+	mem_stat_add(&mem_stats[cat], bytes);
+	mem_stat_add(&mem_stats[CLICK_MEM_NCATS], bytes);
+}
+
+void
+click_mem_netbuf_dtor(struct uk_netbuf *nb)
+{
+	click_mem_add(CLICK_MEM_NETBUFS, -(long) (nb->buflen + sizeof(*nb)));
+}
+
+/* What a block takes from the heap, header included */
+static inline long
+block_bytes(const struct alloc_hdr *h)
+{
+	if (h->cls == ALLOC_LARGE)
+		return ALLOC_PAGES(sizeof(*h) + h->size) << __PAGE_SHIFT;
+	return sizeof(*h) + class_size[h->cls];
+}
+#endif
+
+static inline void
+spin_lock(int *lock)
+{
+	while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(lock, __ATOMIC_RELAXED))
+			;
+}
+
+static inline void
+spin_unlock(int *lock)
+{
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static inline void
+class_lock(struct alloc_class *c)
+{
+	spin_lock(&c->lock);
+}
+
+static inline void
+class_unlock(struct alloc_class *c)
+{
+	spin_unlock(&c->lock);
+}
+
+/* Returns the node in *slot, allocating a zeroed one if there is none */
+static void *
+pmap_node(void **slot, size_t size)
+{
+	void *n = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+	if (n)
+		return n;
+	spin_lock(&pmap_lock);
+	if (!(n = *slot) && (n = uk_calloc(uk_alloc_get_default(), 1, size)))
+		__atomic_store_n(slot, n, __ATOMIC_RELEASE);
+	spin_unlock(&pmap_lock);
+	return n;
+}
+
+/* Returns the bitmap word of page number pn, or NULL if it has none */
+static unsigned long *
+pmap_word(uintptr_t pn, int create)
+{
+	uintptr_t top = pn >> (PMAP_MID_BITS + PMAP_LEAF_BITS);
+	void **mid, **slot;
+	unsigned long *leaf;
+
+	if (top >= (1UL << PMAP_TOP_BITS))
+		return NULL;
+	mid = (void **) (create
+		? pmap_node(&pmap[top], sizeof(void *) << PMAP_MID_BITS)
+		: __atomic_load_n(&pmap[top], __ATOMIC_ACQUIRE));
+	if (!mid)
+		return NULL;
+	slot = &mid[(pn >> PMAP_LEAF_BITS) & ((1UL << PMAP_MID_BITS) - 1)];
+	leaf = (unsigned long *) (create
+		? pmap_node(slot, (1UL << PMAP_LEAF_BITS) / 8)
+		: __atomic_load_n(slot, __ATOMIC_ACQUIRE));
+	if (!leaf)
+		return NULL;
+	return &leaf[(pn & ((1UL << PMAP_LEAF_BITS) - 1)) / PMAP_LONG_BITS];
+}
+
+/* Marks npages pages at addr as ours, or clears them. Marking fails if
+ * the bitmap cannot grow; the caller clears what was marked then.
+ */
+static int
+pmap_mark(const void *addr, size_t npages, int on)
+{
+	uintptr_t pn = (uintptr_t) addr >> __PAGE_SHIFT;
+
+	for (size_t i = 0; i < npages; ++i, ++pn) {
+		unsigned long *w = pmap_word(pn, on);
+		unsigned long bit = 1UL << (pn % PMAP_LONG_BITS);
+
+		if (!w) {
+			if (on)
+				return -1;
+			continue;
+		}
+		if (on)
+			__atomic_or_fetch(w, bit, __ATOMIC_RELAXED);
+		else
+			__atomic_and_fetch(w, ~bit, __ATOMIC_RELAXED);
+	}
+	return 0;
+}
+
+static inline int
+pmap_owned(const void *ptr)
+{
+	uintptr_t pn = (uintptr_t) ptr >> __PAGE_SHIFT;
+	unsigned long *w = pmap_word(pn, 0);
+
+	return w && ((__atomic_load_n(w, __ATOMIC_RELAXED)
+		      >> (pn % PMAP_LONG_BITS)) & 1);
+}
+
+/* Takes npages pages from the default allocator and marks them as ours */
+static void *
+pages_get(size_t npages)
+{
+	void *p = uk_palloc(uk_alloc_get_default(), npages);
+
+	if (p && pmap_mark(p, npages, 1) < 0) {
+		pmap_mark(p, npages, 0);
+		uk_pfree(uk_alloc_get_default(), p, npages);
+		p = NULL;
+	}
+	return p;
+}
+
+static void
+pages_put(void *p, size_t npages)
+{
+	pmap_mark(p, npages, 0);
+	uk_pfree(uk_alloc_get_default(), p, npages);
+}
+
+static inline int
+size_class(size_t size)
+{
+	int i = 0;
+
+	if (size > class_size[ALLOC_NCLASSES - 1])
+		return -1;
+	while (class_size[i] < size)
+		++i;
+	return i;
+}
+
+static inline struct alloc_cache *
+thread_cache()
+{
+	if (unlikely(!my_cache_claimed)) {
+		int i = __atomic_fetch_add(&ncaches, 1, __ATOMIC_RELAXED);
+
+		my_cache = i < ALLOC_NCACHES ? &caches[i] : NULL;
+		my_cache_claimed = 1;
+	}
+	return my_cache;
+}
+
+/* Carves a new slab into the global list; called with the lock held */
+static int
+class_grow(struct alloc_class *c, int cls)
+{
+	size_t bsize = sizeof(struct alloc_hdr) + class_size[cls];
+	size_t n = ALLOC_SLAB / bsize, npages;
+	char *slab;
+
+	if (n < ALLOC_BATCH)
+		n = ALLOC_BATCH;
+	npages = ALLOC_PAGES(n * bsize);
+	slab = (char *) pages_get(npages);
+	if (!slab)
+		return -1;
+	/* use the rest of the last page as well */
+	n = (npages << __PAGE_SHIFT) / bsize;
+	for (size_t i = 0; i < n; ++i) {
+		struct alloc_free *f = (struct alloc_free *) (slab + i * bsize);
+		f->next = c->head;
+		c->head = f;
+	}
+	c->count += n;
+	c->slab_bytes += npages << __PAGE_SHIFT;
+	return 0;
+}
+
+static struct alloc_free *
+class_get(int cls)
+{
+	struct alloc_class *c = &classes[cls];
+	struct alloc_free *f = NULL;
+
+	class_lock(c);
+	if (c->head || class_grow(c, cls) == 0) {
+		f = c->head;
+		c->head = f->next;
+		c->count--;
+	}
+	class_unlock(c);
+	return f;
+}
+
+static void
+class_put(int cls, struct alloc_free *first, struct alloc_free *last,
+	  uint32_t n)
+{
+	struct alloc_class *c = &classes[cls];
+
+	class_lock(c);
+	last->next = c->head;
+	c->head = first;
+	c->count += n;
+	class_unlock(c);
+}
+
+/* Moves up to a batch of blocks from the global list into the cache */
+static void
+cache_refill(struct alloc_cache *tc, int cls)
+{
+	struct alloc_class *c = &classes[cls];
+	uint32_t n = 0;
+
+	class_lock(c);
+	if (!c->head)
+		class_grow(c, cls);
+	while (c->head && n < ALLOC_BATCH) {
+		struct alloc_free *f = c->head;
+		c->head = f->next;
+		f->next = tc->head[cls];
+		tc->head[cls] = f;
+		++n;
+	}
+	c->count -= n;
+	class_unlock(c);
+	tc->count[cls] += n;
+}
+
+/* Hands a batch back once the cache holds two */
+static void
+cache_trim(struct alloc_cache *tc, int cls)
+{
+	struct alloc_free *first = tc->head[cls], *last = first;
+
+	for (uint32_t i = 1; i < ALLOC_BATCH; ++i)
+		last = last->next;
+	tc->head[cls] = last->next;
+	tc->count[cls] -= ALLOC_BATCH;
+	class_put(cls, first, last, ALLOC_BATCH);
+}
+
+static inline void *
+block_init(struct alloc_free *f, int cls, size_t size)
+{
+	struct alloc_hdr *h = (struct alloc_hdr *) f;
+
+	h->magic = ALLOC_MAGIC;
+	h->cls = cls;
+	h->size = size;
+#if CONFIG_LIBCLICK_MEMSTATS
+	h->cat = click_mem_cat;
+	click_mem_add(h->cat, block_bytes(h));
+#endif
+	return h + 1;
+}
+
+extern "C" void *
+click_malloc(size_t size)
+{
+	struct alloc_cache *tc;
+	struct alloc_free *f;
+	struct alloc_hdr *h;
+	int cls = size_class(size);
+
+	if (unlikely(cls < 0)) {
+		h = (struct alloc_hdr *) pages_get(ALLOC_PAGES(sizeof(*h) + size));
+		if (!h)
+			return NULL;
+		__atomic_add_fetch(&large_allocs, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&large_bytes, size, __ATOMIC_RELAXED);
+		h->magic = ALLOC_MAGIC;
+		h->cls = ALLOC_LARGE;
+		h->size = size;
+#if CONFIG_LIBCLICK_MEMSTATS
+		h->cat = click_mem_cat;
+		click_mem_add(h->cat, block_bytes(h));
+#endif
+		return h + 1;
+	}
+
+	tc = thread_cache();
+	if (unlikely(!tc)) {
+		f = class_get(cls);
+		if (!f)
+			return NULL;
+		__atomic_add_fetch(&classes[cls].allocs, 1, __ATOMIC_RELAXED);
+		return block_init(f, cls, size);
+	}
+
+	if (unlikely(!tc->head[cls])) {
+		cache_refill(tc, cls);
+		if (!tc->head[cls])
+			return NULL;
+	}
+	f = tc->head[cls];
+	tc->head[cls] = f->next;
+	tc->count[cls]--;
+	tc->allocs[cls]++;
+	return block_init(f, cls, size);
+}
+
+extern "C" void
+click_free(void *ptr)
+{
+	struct alloc_hdr *h;
+	struct alloc_free *f;
+	struct alloc_cache *tc;
+	uint32_t cls;
+
+	if (!ptr)
+		return;
+	if (unlikely(!pmap_owned(ptr))) {
+		/* not ours, e.g. from a libc function called by the glue */
+		free(ptr);
+		return;
+	}
+	h = (struct alloc_hdr *) ptr - 1;
+	UK_ASSERT(h->magic == ALLOC_MAGIC);
+	h->magic = 0;
+	cls = h->cls;
+#if CONFIG_LIBCLICK_MEMSTATS
+	click_mem_add(h->cat, -block_bytes(h));
+#endif
+
+	if (unlikely(cls == ALLOC_LARGE)) {
+		__atomic_add_fetch(&large_frees, 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&large_bytes, h->size, __ATOMIC_RELAXED);
+		pages_put(h, ALLOC_PAGES(sizeof(*h) + h->size));
+		return;
+	}
+
+	f = (struct alloc_free *) h;
+	tc = thread_cache();
+	if (unlikely(!tc)) {
+		f->next = NULL;
+		class_put(cls, f, f, 1);
+		__atomic_add_fetch(&classes[cls].frees, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	f->next = tc->head[cls];
+	tc->head[cls] = f;
+	tc->frees[cls]++;
+	if (++tc->count[cls] >= 2 * ALLOC_BATCH)
+		cache_trim(tc, cls);
+}
+
+extern "C" void *
+click_calloc(size_t nmemb, size_t size)
+{
+	void *p;
+
+	if (size && nmemb > (size_t) -1 / size)
+		return NULL;
+	p = click_malloc(nmemb * size);
+	if (p)
+		memset(p, 0, nmemb * size);
+	return p;
+}
+
+extern "C" void *
+click_realloc(void *ptr, size_t size)
+{
+	struct alloc_hdr *h;
+	size_t room;
+	void *n;
+
+	if (!ptr)
+		return click_malloc(size);
+	if (!size) {
+		click_free(ptr);
+		return NULL;
+	}
+	if (unlikely(!pmap_owned(ptr)))
+		return realloc(ptr, size);
+	h = (struct alloc_hdr *) ptr - 1;
+	UK_ASSERT(h->magic == ALLOC_MAGIC);
+
+	room = h->cls == ALLOC_LARGE ? h->size : class_size[h->cls];
+	if (size <= room && h->cls != ALLOC_LARGE) {
+		h->size = size;
+		return ptr;
+	}
+	n = click_malloc(size);
+	if (n) {
+		memcpy(n, ptr, h->size < size ? h->size : size);
+		click_free(ptr);
+	}
+	return n;
+}
+
+static String
+read_alloc_stats(Element *, void *)
+{
+	StringAccum sa;
+
+	sa.snprintf(96, "%5s %10s %10s %10s %10s %14s %14s\n", "size",
+		    "in_use", "cached", "free", "slab_kb", "allocs", "frees");
+	for (int cls = 0; cls < ALLOC_NCLASSES; ++cls) {
+		struct alloc_class *c = &classes[cls];
+		uint64_t allocs = c->allocs, frees = c->frees, cached = 0;
+		int n = ncaches < ALLOC_NCACHES ? ncaches : ALLOC_NCACHES;
+
+		for (int i = 0; i < n; ++i) {
+			allocs += caches[i].allocs[cls];
+			frees += caches[i].frees[cls];
+			cached += caches[i].count[cls];
+		}
+		sa.snprintf(128, "%5u %10lld %10llu %10u %10lu %14llu %14llu\n",
+			    class_size[cls], (long long) (allocs - frees),
+			    (unsigned long long) cached, c->count,
+			    (unsigned long) (c->slab_bytes >> 10),
+			    (unsigned long long) allocs,
+			    (unsigned long long) frees);
+	}
+	sa.snprintf(128, "%5s %10lld %10s %10s %10lu %14llu %14llu\n", "large",
+		    (long long) (large_allocs - large_frees), "-", "-",
+		    (unsigned long) (large_bytes >> 10),
+		    (unsigned long long) large_allocs,
+		    (unsigned long long) large_frees);
+	return sa.take_string();
+}
+
+#if CONFIG_LIBCLICK_MEMSTATS
+static String
+read_memory(Element *, void *)
+{
+	StringAccum sa;
+	size_t slabs = 0;
+
+	sa.snprintf(64, "%-10s %12s %12s\n", "category", "kb", "peak_kb");
+	for (int c = 0; c <= CLICK_MEM_NCATS; ++c)
+		sa.snprintf(96, "%-10s %12lld %12lld\n",
+			    c < CLICK_MEM_NCATS ? mem_cat_name[c] : "total",
+			    (long long) (mem_stats[c].cur >> 10),
+			    (long long) (mem_stats[c].peak >> 10));
+	/* heap held in slabs, whether handed out or not */
+	for (int cls = 0; cls < ALLOC_NCLASSES; ++cls)
+		slabs += classes[cls].slab_bytes;
+	sa.snprintf(64, "%-10s %12lu\n", "slabs", (unsigned long) (slabs >> 10));
+	return sa.take_string();
+}
+
+static int
+write_memory_reset(const String &, Element *, void *, ErrorHandler *)
+{
+	for (int c = 0; c <= CLICK_MEM_NCATS; ++c)
+		__atomic_store_n(&mem_stats[c].peak,
+				 __atomic_load_n(&mem_stats[c].cur, __ATOMIC_RELAXED),
+				 __ATOMIC_RELAXED);
+	return 0;
+}
+#endif
+
+void
+click_alloc_init()
+{
+	Router::add_read_handler(0, "alloc_stats", read_alloc_stats, 0);
+#if CONFIG_LIBCLICK_MEMSTATS
+	Router::add_read_handler(0, "memory", read_memory, 0);
+	Router::add_write_handler(0, "memory_reset", write_memory_reset, 0,
+				  Handler::BUTTON);
+#endif
+}
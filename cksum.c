@@ -0,0 +1,371 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Vectorized internet checksum. The instruction set is picked at build
+ * time from what the Unikraft architecture config lets the compiler use:
+ * AVX2 or SSE2 on x86_64, NEON on arm64, and a plain loop otherwise.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <click_cksum.h>
+
+#if CONFIG_LIBCLICK_SIMD_CKSUM && defined(__AVX2__)
+#include <immintrin.h>
+#define CKSUM_VEC_AVX2 1
+#define CKSUM_VEC_BYTES 32
+#elif CONFIG_LIBCLICK_SIMD_CKSUM && defined(__SSE2__)
+#include <emmintrin.h>
+#define CKSUM_VEC_SSE2 1
+#define CKSUM_VEC_BYTES 16
+#elif CONFIG_LIBCLICK_SIMD_CKSUM && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CKSUM_VEC_NEON 1
+#define CKSUM_VEC_BYTES 16
+#else
+#define CKSUM_VEC_BYTES 0
+#endif
+
+#if CKSUM_VEC_BYTES
+/* Every vector adds at most 2 * 0xffff to each 32-bit lane, so lanes are
+ * drained into the 64-bit total before they can overflow.
+ */
+#define CKSUM_VEC_BLOCK (CKSUM_VEC_BYTES * 16384)
+
+static uint64_t
+cksum_vec(const unsigned char *p, size_t n)
+{
+	uint64_t total = 0;
+	size_t chunk;
+
+	while (n) {
+		chunk = n < CKSUM_VEC_BLOCK ? n : CKSUM_VEC_BLOCK;
+		n -= chunk;
+#if CKSUM_VEC_AVX2
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			__m256i acc = zero;
+			uint32_t lanes[8];
+			int i;
+
+			for (; chunk; chunk -= 32, p += 32) {
+				__m256i v = _mm256_loadu_si256(
+						(const __m256i *)p);
+
+				acc = _mm256_add_epi32(acc,
+					_mm256_unpacklo_epi16(v, zero));
+				acc = _mm256_add_epi32(acc,
+					_mm256_unpackhi_epi16(v, zero));
+			}
+			_mm256_storeu_si256((__m256i *)lanes, acc);
+			for (i = 0; i < 8; ++i)
+				total += lanes[i];
+		}
+#elif CKSUM_VEC_SSE2
+		{
+			const __m128i zero = _mm_setzero_si128();
+			__m128i acc = zero;
+			uint32_t lanes[4];
+			int i;
+
+			for (; chunk; chunk -= 16, p += 16) {
+				__m128i v = _mm_loadu_si128((const __m128i *)p);
+
+				acc = _mm_add_epi32(acc,
+					_mm_unpacklo_epi16(v, zero));
+				acc = _mm_add_epi32(acc,
+					_mm_unpackhi_epi16(v, zero));
+			}
+			_mm_storeu_si128((__m128i *)lanes, acc);
+			for (i = 0; i < 4; ++i)
+				total += lanes[i];
+		}
+#elif CKSUM_VEC_NEON
+		{
+			uint32x4_t acc = vdupq_n_u32(0);
+
+			for (; chunk; chunk -= 16, p += 16)
+				acc = vpadalq_u16(acc,
+					vreinterpretq_u16_u8(vld1q_u8(p)));
+			total += vaddlvq_u32(acc);
+		}
+#endif
+	}
+	return total;
+}
+#endif /* CKSUM_VEC_BYTES */
+
+static uint32_t
+cksum_fold64(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	return click_cksum_fold((uint32_t)sum);
+}
+
+uint16_t
+click_cksum_partial(const unsigned char *addr, int len, uint16_t sum)
+{
+	uint64_t total = sum;
+	uint16_t w;
+#if CKSUM_VEC_BYTES
+	size_t n;
+#endif
+
+	if (len <= 0)
+		return sum;
+
+#if CKSUM_VEC_BYTES
+	n = (size_t)len & ~(size_t)(CKSUM_VEC_BYTES - 1);
+	if (n) {
+		total += cksum_vec(addr, n);
+		addr += n;
+		len -= n;
+	}
+#endif
+	for (; len > 1; len -= 2, addr += 2) {
+		memcpy(&w, addr, 2);
+		total += w;
+	}
+	/* Trailing byte is padded with zero, as in lib/in_cksum.c */
+	if (len == 1) {
+		w = 0;
+		*(unsigned char *)&w = *addr;
+		total += w;
+	}
+	return cksum_fold64(total);
+}
+
+#if CONFIG_LIBCLICK_SIMD_CKSUM
+/* Replaces the definition from lib/in_cksum.c, which is compiled as
+ * click_in_cksum_scalar() instead (see Makefile.uk).
+ */
+uint16_t
+click_in_cksum(const unsigned char *addr, int len)
+{
+	return ~click_cksum_partial(addr, len, 0);
+}
+#endif
+
+#if CONFIG_LIBCLICK_CKSUM_SELFTEST
+#include <uk/print.h>
+
+#define SELFTEST_MAXLEN 9216
+#define SELFTEST_ROUNDS 4096
+#define SELFTEST_HDR_ROUNDS 65536
+
+static uint32_t
+selftest_rand(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static uint16_t
+selftest_get16(const unsigned char *h, int off)
+{
+	uint16_t w;
+
+	memcpy(&w, h + off, 2);
+	return w;
+}
+
+static void
+selftest_put16(unsigned char *h, int off, uint16_t w)
+{
+	memcpy(h + off, &w, 2);
+}
+
+/* Checksum of the 20-byte IPv4 header at h, recomputed from scratch */
+static uint16_t
+selftest_ip_cksum(unsigned char *h)
+{
+	uint16_t saved = selftest_get16(h, 10), sum;
+
+	selftest_put16(h, 10, 0);
+	sum = click_in_cksum_scalar(h, 20);
+	selftest_put16(h, 10, saved);
+	return sum;
+}
+
+/* Sets the last two bytes of the len (2 or 4) bytes at off so that the
+ * header sums to 0xffff, i.e. its checksum is 0x0000, the case RFC 1624
+ * is about.
+ */
+static void
+selftest_zero_sum(unsigned char *h, int off, int len)
+{
+	uint16_t saved = selftest_get16(h, 10);
+
+	selftest_put16(h, 10, 0);
+	selftest_put16(h, off + len - 2, 0);
+	selftest_put16(h, off + len - 2,
+		       (uint16_t)~click_cksum_partial(h, 20, 0));
+	selftest_put16(h, 10, saved);
+}
+
+/* Writes a new value into the len (2 or 4) bytes at off: all zeros, all
+ * ones, one that zeroes the checksum, or random
+ */
+static void
+selftest_field(uint32_t *state, unsigned char *h, int off, int len)
+{
+	uint32_t w;
+
+	switch (selftest_rand(state) % 4) {
+	case 0:
+		memset(h + off, 0, len);
+		break;
+	case 1:
+		memset(h + off, 0xff, len);
+		break;
+	case 2:
+		selftest_zero_sum(h, off, len);
+		break;
+	default:
+		w = selftest_rand(state);
+		memcpy(h + off, &w, len);
+		break;
+	}
+}
+
+/* Applies random mutations to an IPv4 header through the incremental
+ * updates of click_cksum.h and compares the checksum each time with one
+ * computed from scratch. Fields other than the version byte, which keeps
+ * the header from summing to zero, take 0x0000, 0xffff and values that
+ * bring the checksum to 0x0000 along with random ones.
+ */
+static int
+selftest_adjust(uint32_t *state)
+{
+	static const int off32[] = { 4, 12, 16 };
+	unsigned char h[20];
+	uint32_t old32, new32;
+	uint16_t old16, new16, csum, ref;
+	int round, off, errors = 0;
+	const char *what;
+
+	for (round = 0; round < SELFTEST_HDR_ROUNDS; ++round) {
+		if (round % 256 == 0) {
+			for (off = 0; off < 20; ++off)
+				h[off] = (unsigned char)selftest_rand(state);
+			h[0] = 0x45;
+			if (round % 512 == 0)
+				selftest_zero_sum(h, 4, 2);
+			selftest_put16(h, 10, selftest_ip_cksum(h));
+		}
+		csum = selftest_get16(h, 10);
+
+		switch (selftest_rand(state) % 3) {
+		case 0:
+			/* any word but the version byte's and the checksum */
+			off = 2 + 2 * (int)(selftest_rand(state) % 8);
+			if (off >= 10)
+				off += 2;
+			old16 = selftest_get16(h, off);
+			selftest_field(state, h, off, 2);
+			new16 = selftest_get16(h, off);
+			csum = click_cksum_adjust16(csum, old16, new16);
+			what = "adjust16";
+			break;
+		case 1:
+			off = off32[selftest_rand(state) % 3];
+			memcpy(&old32, h + off, 4);
+			selftest_field(state, h, off, 4);
+			memcpy(&new32, h + off, 4);
+			csum = click_cksum_adjust32(csum, old32, new32);
+			what = "adjust32";
+			break;
+		default:
+			off = 8;
+			if (!h[8]) {
+				h[8] = (unsigned char)(1 + selftest_rand(state) % 255);
+				csum = selftest_ip_cksum(h);
+			}
+			selftest_put16(h, 10, csum);
+			click_cksum_ip_ttl_dec(h);
+			csum = selftest_get16(h, 10);
+			what = "ttl_dec";
+			break;
+		}
+
+		ref = selftest_ip_cksum(h);
+		if (csum != ref) {
+			uk_pr_err("cksum %s mismatch: off %d: %04x != %04x\n",
+				  what, off, csum, ref);
+			++errors;
+			csum = ref;
+		}
+		selftest_put16(h, 10, csum);
+	}
+	return errors;
+}
+
+int
+click_cksum_selftest(void)
+{
+	static unsigned char buf[SELFTEST_MAXLEN + 64];
+	uint32_t state = 0x2545f491;
+	uint16_t ref, vec;
+	int round, len, off, i;
+	int errors = 0;
+
+	for (round = 0; round < SELFTEST_ROUNDS; ++round) {
+		/* Mix in all-ones and all-zero buffers to hit the fold
+		 * corner cases
+		 */
+		len = round < SELFTEST_MAXLEN / 8 ? round
+			: (int)(selftest_rand(&state) % SELFTEST_MAXLEN);
+		off = (int)(selftest_rand(&state) % 64);
+		for (i = 0; i < len; ++i) {
+			if (round % 7 == 1)
+				buf[off + i] = 0xff;
+			else if (round % 7 == 2)
+				buf[off + i] = 0;
+			else
+				buf[off + i] = (unsigned char)selftest_rand(&state);
+		}
+		ref = click_in_cksum_scalar(buf + off, len);
+		vec = click_in_cksum(buf + off, len);
+		if (ref != vec) {
+			uk_pr_err("cksum mismatch: len %d off %d: %04x != %04x\n",
+				  len, off, vec, ref);
+			++errors;
+		}
+	}
+	return errors + selftest_adjust(&state);
+}
+#endif /* CONFIG_LIBCLICK_CKSUM_SELFTEST */
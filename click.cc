@@ -49,15 +49,32 @@ extern "C"{
 #include <click/string.hh>
 #include <click/straccum.hh>
 #include <click/driver.hh>
+#include <click/archive.hh>
+#include <click/handler.hh>
 
 #include <static_config.h>
+#include <click_cksum.h>
+#include <click_tables.h>
+#include <click_alloc.h>
+#if CONFIG_LIBCLICK_CONTROL
+#include <click_control.h>
+#endif
+#if CONFIG_LIBCLICK_SPECIALIZE
+#include <specialized.h>
+#endif
 
 #include <uk/sched.h>
 #include <uk/thread.h>
 #include <uk/netdev.h>
 #include <uk/plat/memory.h>
 
-int click_nthreads = 1;
+#if HAVE_MULTITHREAD
+#define CLICK_NTHREADS CONFIG_LIBCLICK_NTHREADS
+#else
+#define CLICK_NTHREADS 1
+#endif
+
+int click_nthreads = CLICK_NTHREADS;
 void *__dso_handle = NULL;
 
 #define NLOG(fmt, ...)
@@ -116,9 +133,14 @@ read_config(u_int rid = 0)
  * click glue
  */
 
+#ifdef CONFIG_LIBCLICK_MAX_ROUTERS
+#define MAX_ROUTERS	CONFIG_LIBCLICK_MAX_ROUTERS
+#else
 #define MAX_ROUTERS	64
+#endif
 static ErrorHandler *errh;
-static Master master(1);
+static Master master(CLICK_NTHREADS);
+static struct uk_thread *driver_threads[CLICK_NTHREADS];
 static String macaddr_preamble;
 
 static void
@@ -148,21 +170,59 @@ make_macaddr_preamble()
 	uk_pr_info("MAC address macros:\n%s\n", macaddr_preamble.c_str());
 }
 
+/* Members of the initrd if it is an ar archive: "config" holds the
+ * configuration, the others data for elements, such as route tables.
+ */
+static Vector<ArchiveElement> initrd_members;
+
+bool
+click_initrd_member(const String &name, String &data)
+{
+	for (int i = 0; i < initrd_members.size(); ++i)
+		if (initrd_members[i].name == name) {
+			data = initrd_members[i].data;
+			return true;
+		}
+	return false;
+}
+
 static String *
 get_config()
 {
 	String *cfg = new String(macaddr_preamble);
 	struct ukplat_memregion_desc *img;
-	char *cstr;
-	size_t cstr_len;
+	String archived;
+	char *cstr = NULL;
+	size_t cstr_len = 0;
 
 	UK_ASSERT(!macaddr_preamble.empty());
 
-	/* First, try initrd */
+	/* An archive is referenced in place, without copying its members */
+	initrd_members.clear();
 	if (ukplat_memregion_find_initrd0(&img) >= 0) {
 		cstr = (char *)img->pbase;
 		cstr_len = img->len;
-	} else {
+		if (cstr_len >= 8 && !memcmp(cstr, "!<arch>\n", 8)) {
+			String ar = String::make_stable(cstr, cstr_len);
+
+			if (ArchiveElement::parse(ar, initrd_members, errh) < 0
+			    || !click_initrd_member("config", archived))
+				uk_pr_err("initrd archive has no config member!\n");
+			cstr = (char *)archived.data();
+			cstr_len = archived.length();
+		}
+	}
+
+#if CONFIG_LIBCLICK_SPECIALIZE
+	/* The specialized element classes only fit the config they were
+	 * generated from, so that one always wins.
+	 */
+	if (cstr_len)
+		uk_pr_warn("Ignoring initrd config, using specialized config!\n");
+	cstr = (char *)SPECIALIZED_CONFIGSTRING;
+	cstr_len = sizeof(SPECIALIZED_CONFIGSTRING) - 1;
+#else
+	if (!cstr_len) {
 		/* If we can't find a config: use a fallback one statically
 		 * compiled in.
 		 */
@@ -170,6 +230,7 @@ get_config()
 		cstr = CONFIGSTRING;
 		cstr_len = strlen(CONFIGSTRING);
 	}
+#endif
 	cfg->append(cstr, cstr_len);
 	printf("Received config (length %d):\n", cfg->length());
 	printf("%s\n", cfg->c_str());
@@ -181,26 +242,77 @@ struct router_instance {
 	u_int f_stop;
 } router_list[MAX_ROUTERS];
 
+/* Returns the scheduler of the i-th CPU other than the current one. On
+ * SMP builds every CPU registers a scheduler of its own; RouterThread i
+ * runs on the i-th of them, thread 0 stays on the boot CPU.
+ */
+static struct uk_sched *
+driver_sched(long i)
+{
+	struct uk_sched *s, *cur = uk_sched_current();
+	long n = 0;
+
+	uk_sched_foreach(s)
+		if (s != cur && ++n == i)
+			return s;
+	return NULL;
+}
+
+/* Drives RouterThread 1 and up; router_thread() drives thread 0 */
+static void
+driver_thread(void *thread_data)
+{
+	ClickMemScope mem(CLICK_MEM_PACKETS);
+
+	master.thread((long)thread_data)->driver();
+}
+
 void
 router_thread(void *thread_data)
 {
 	struct router_instance *ri = &router_list[(unsigned long)thread_data];
-	String *config = get_config();
+	String *config;
 
-	ri->r = click_read_router(*config, true, errh, false, &master);
-	if (ri->r->initialize(errh) < 0) {
-		LOG("Router init failed!");
+	/* one CPU per thread, or the threads would only take turns */
+	if (CLICK_NTHREADS > 1 && !driver_sched(CLICK_NTHREADS - 1)) {
+		LOG("%d router threads need as many CPUs with a scheduler!",
+		    CLICK_NTHREADS);
 		ri->f_stop = 1;
 		return;
 	}
+	config = get_config();
+
+	{
+		ClickMemScope mem(CLICK_MEM_ELEMENTS);
+
+		ri->r = click_read_router(*config, true, errh, false, &master);
+		if (ri->r->initialize(errh) < 0) {
+			LOG("Router init failed!");
+			ri->f_stop = 1;
+			return;
+		}
+	}
 
 	ri->r->use();
 	ri->r->activate(errh);
+#if CONFIG_LIBCLICK_CONTROL
+	click_control_start(ri->r, errh);
+#endif
 
 	LOG("Starting driver...\n\n");
-	ri->r->master()->thread(0)->driver();
+	for (long i = 1; i < CLICK_NTHREADS; ++i)
+		driver_threads[i] = uk_sched_thread_create(driver_sched(i),
+				driver_thread, (void *)i, "click-driver");
+	{
+		ClickMemScope mem(CLICK_MEM_PACKETS);
+
+		ri->r->master()->thread(0)->driver();
+	}
 
 	LOG("Stopping driver...\n\n");
+	for (int i = 1; i < CLICK_NTHREADS; ++i)
+		while (driver_threads[i] && !uk_thread_is_exited(driver_threads[i]))
+			uk_sched_yield();
 	ri->r->unuse();
 	ri->f_stop = 1;
 
@@ -228,41 +340,27 @@ router_stop(int n = MAX_ROUTERS)
 	LOG("Stopped all routers...\n\n");
 }
 
-/* Initialize all netdev devices to the point where you can get a MAC
- * address from them.
+/* Probe all netdev devices so that their MAC addresses can be read. They
+ * are configured and started by NetDevice (unikraft/netdevice.cc), once
+ * the router says how.
  */
-static int
-uk_netdev_early_init(ErrorHandler *errh)
+static void
+uk_netdev_early_init(void)
 {
 	struct uk_netdev *netdev;
-	struct uk_netdev_conf netdev_conf;
 	int ret;
 
-	netdev_conf.nb_rx_queues = 1;
-	netdev_conf.nb_tx_queues = 1;
 	for (unsigned int i = 0; i < uk_netdev_count(); ++i) {
 		netdev = uk_netdev_get(i);
 
 		if (!netdev)
 			continue;
-		if (uk_netdev_state_get(netdev) != UK_NETDEV_UNCONFIGURED &&
-				uk_netdev_state_get(netdev) != UK_NETDEV_UNPROBED) {
-			uk_pr_info("Skipping to add network device %u to lwIP: Not in unconfigured state\n", i);
+		if (uk_netdev_state_get(netdev) != UK_NETDEV_UNPROBED)
 			continue;
-		}
-
-		if (uk_netdev_state_get(netdev) == UK_NETDEV_UNPROBED) {
-			ret = uk_netdev_probe(netdev);
-			if (ret < 0) {
-				uk_pr_err("Failed to probe network device %u %d", i, ret);
-				continue;
-			}
-		}
-		uk_pr_info("netdev %d early init\n", i);
-		if (uk_netdev_configure(netdev, &netdev_conf) < 0)
-			return errh->error("Failed to configure device %d\n", i);
+		ret = uk_netdev_probe(netdev);
+		if (ret < 0)
+			uk_pr_err("Failed to probe network device %u %d", i, ret);
 	}
-	return 0;
 }
 
 #if CLICK_CONSOLE_SUPPORT_IMPLEMENTED
@@ -395,6 +493,19 @@ on_router(char *key, void *data)
 }
 #endif /* CLICK_CONSOLE_SUPPORT_IMPLEMENTED */
 
+#if CONFIG_LIBCLICK_PGO_GENERATE
+/* libgcov; the profile is normally written at exit, which never comes */
+extern "C" void __gcov_dump(void);
+
+static int
+pgo_dump_handler(const String &, Element *, void *, ErrorHandler *)
+{
+	__gcov_dump();
+	LOG("Profile written to %s", CONFIG_LIBCLICK_PGO_DIR);
+	return 0;
+}
+#endif
+
 #if CONFIG_LIBCLICK_MAIN
 #define CLICK_MAIN main
 #else
@@ -408,6 +519,16 @@ int CLICK_MAIN(int argc, char **argv)
 	struct uk_thread *router;
 
 	click_static_initialize();
+#if CONFIG_LIBCLICK_ALLOC
+	click_alloc_init();
+#endif
+#if CONFIG_LIBCLICK_PGO_GENERATE
+	Router::add_write_handler(0, "pgo_dump", pgo_dump_handler, 0,
+				  Handler::BUTTON);
+#endif
+#if CONFIG_LIBCLICK_SPECIALIZE
+	click_specialized_init();
+#endif
 	errh = ErrorHandler::default_handler();
 
 	memset(router_list, 0, MAX_ROUTERS * sizeof(struct router_instance));
@@ -415,8 +536,30 @@ int CLICK_MAIN(int argc, char **argv)
 		router_list[i].f_stop = 1;
 	}
 
-	if (uk_netdev_early_init(errh))
+#if CONFIG_LIBCLICK_CKSUM_SELFTEST
+	if (click_cksum_selftest()) {
+		LOG("Checksum self-test failed!");
+		return -EINVAL;
+	}
+#endif
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+	if (click_lookup_selftest()) {
+		LOG("Route lookup self-test failed!");
+		return -EINVAL;
+	}
+#endif
+#if CONFIG_LIBCLICK_FLOWTABLE_SELFTEST
+	if (click_flowtable_selftest()) {
+		LOG("Flow table self-test failed!");
+		return -EINVAL;
+	}
+#endif
+
+#if CONFIG_LIBCLICK_CONTROL
+	if (click_control_init(errh))
 		return -EINVAL;
+#endif
+	uk_netdev_early_init();
 	make_macaddr_preamble();
 
 #if CLICK_CONSOLE_SUPPORT_IMPLEMENTED
@@ -443,6 +586,9 @@ int CLICK_MAIN(int argc, char **argv)
 		uk_sched_yield();
 #endif
 	LOG("Shutting down...");
+#if CONFIG_LIBCLICK_PGO_GENERATE
+	pgo_dump_handler(String(), 0, 0, 0);
+#endif
 
 	return _reason;
 }
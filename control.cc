@@ -0,0 +1,525 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Control socket: serves Click's read/write handlers to a monitoring host
+ * over lwIP, speaking the ControlSocket protocol (version 1.3) on TCP and,
+ * one request per datagram, on UDP.
+ *
+ * lwIP gets a netdev of its own, so control traffic never goes through the
+ * router's FromDevice/ToDevice elements. Requests are served by a dedicated
+ * thread that mostly sleeps in poll(). Unikraft's cooperative scheduler has
+ * no priorities, so this thread and lwIP's only run when the router thread
+ * yields: by itself when FromDevice is idle in interrupt mode, and from a
+ * timer every LIBCLICK_CONTROL_YIELD_MS even while the router is busy. Handlers are therefore never called from inside a RouterThread.
+ *
+ * On top of the standard commands, "READMANY h1 h2 ..." reads several
+ * handlers in one round trip; the reply is the concatenation of the
+ * replies to "READ h1", "READ h2", ...
+ */
+
+extern "C" {
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/confparse.hh>
+#include <click/element.hh>
+#include <click/handler.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+
+#include <click_control.h>
+
+#include <lwip/ip_addr.h>
+#include <lwip/netif.h>
+#include <netif/uknetdev.h>
+
+#include <uk/print.h>
+#include <uk/sched.h>
+#include <uk/thread.h>
+#include <uk/netdev.h>
+
+#define CONTROL_BANNER		"Click::ControlSocket/1.3\r\n"
+#define CONTROL_MAX_LINE	4096
+/* room for binary route tables, see click_tables.h */
+#define CONTROL_MAX_DATA	(1 << 26)
+#define CONTROL_MAX_CLIENTS	CONFIG_LIBCLICK_CONTROL_MAX_CLIENTS
+
+/* ControlSocket status codes */
+enum {
+	CSERR_OK		= 200,
+	CSERR_SYNTAX		= 500,
+	CSERR_UNIMPLEMENTED	= 501,
+	CSERR_NO_SUCH_ELEMENT	= 510,
+	CSERR_NO_SUCH_HANDLER	= 511,
+	CSERR_HANDLER_ERROR	= 520,
+	CSERR_DATA_TOO_BIG	= 521,
+	CSERR_PERMISSION	= 530,
+	CSERR_NO_ROUTER		= 540,
+};
+
+struct control_client {
+	int fd;
+	StringAccum in;
+	/* bytes still expected for a WRITEDATA command */
+	int want;
+	String write_handler;
+};
+
+static Router *control_router;
+static struct control_client clients[CONTROL_MAX_CLIENTS];
+static int tcp_fd = -1;
+static int udp_fd = -1;
+#if CONFIG_LIBCLICK_CONTROL_YIELD_MS
+static Timer yield_timer;
+
+static void
+yield_hook(Timer *t, void *)
+{
+	uk_sched_yield();
+	t->reschedule_after_msec(CONFIG_LIBCLICK_CONTROL_YIELD_MS);
+}
+#endif
+
+static int
+find_handler(const String &name, Element *&e, const Handler *&h,
+	     StringAccum &out)
+{
+	const char *dot = name.begin();
+
+	while (dot < name.end() && *dot != '.')
+		++dot;
+	if (dot < name.end()) {
+		String ename = name.substring(name.begin(), dot);
+		e = control_router->find(ename);
+		if (!e) {
+			out << CSERR_NO_SUCH_ELEMENT << " No element named '"
+			    << ename << "'\r\n";
+			return -1;
+		}
+		h = Router::handler(e, name.substring(dot + 1, name.end()));
+	} else {
+		e = control_router->root_element();
+		h = Router::handler(e, name);
+	}
+	if (!h) {
+		out << CSERR_NO_SUCH_HANDLER << " No handler named '" << name
+		    << "'\r\n";
+		return -1;
+	}
+	return 0;
+}
+
+static void
+do_read(const String &name, const String &param, StringAccum &out)
+{
+	Element *e;
+	const Handler *h;
+	ErrorHandler *errh = ErrorHandler::silent_handler();
+	int before = errh->nerrors();
+	String data;
+
+	if (find_handler(name, e, h, out) < 0)
+		return;
+	if (!h->readable() || (param && !h->read_param())) {
+		out << CSERR_PERMISSION << " Handler '" << name
+		    << "' is not readable\r\n";
+		return;
+	}
+	data = h->call_read(e, param, errh);
+	if (errh->nerrors() != before) {
+		out << CSERR_HANDLER_ERROR << " Read handler '" << name
+		    << "' error\r\n";
+		return;
+	}
+	out << CSERR_OK << " Read handler '" << name << "' OK\r\nDATA "
+	    << data.length() << "\r\n" << data;
+}
+
+static void
+do_write(const String &name, const String &data, StringAccum &out)
+{
+	Element *e;
+	const Handler *h;
+	ErrorHandler *errh = ErrorHandler::silent_handler();
+	int before = errh->nerrors();
+
+	if (find_handler(name, e, h, out) < 0)
+		return;
+	if (!h->writable()) {
+		out << CSERR_PERMISSION << " Handler '" << name
+		    << "' is not writable\r\n";
+		return;
+	}
+	if (h->call_write(data, e, errh) < 0 || errh->nerrors() != before) {
+		out << CSERR_HANDLER_ERROR << " Write handler '" << name
+		    << "' error\r\n";
+		return;
+	}
+	out << CSERR_OK << " Write handler '" << name << "' OK\r\n";
+}
+
+static void
+do_check(const String &name, bool write, StringAccum &out)
+{
+	Element *e;
+	const Handler *h;
+
+	if (find_handler(name, e, h, out) < 0)
+		return;
+	if (write ? !h->writable() : !h->readable())
+		out << CSERR_PERMISSION << " Handler '" << name << "' is not "
+		    << (write ? "writable" : "readable") << "\r\n";
+	else
+		out << CSERR_OK << " Handler '" << name << "' OK\r\n";
+}
+
+/* Executes one command line. Returns -1 if the connection should be
+ * closed, otherwise 0.
+ */
+static int
+do_command(struct control_client *c, const String &line, StringAccum &out)
+{
+	String rest = line;
+	String cmd = cp_shift_spacevec(rest).upper();
+
+	if (!cmd)
+		return 0;
+	if (!control_router) {
+		out << CSERR_NO_ROUTER << " No router installed\r\n";
+		return 0;
+	}
+
+	if (cmd == "READ") {
+		String name = cp_shift_spacevec(rest);
+		do_read(name, rest, out);
+	} else if (cmd == "READMANY") {
+		String name;
+		while ((name = cp_shift_spacevec(rest)))
+			do_read(name, String(), out);
+	} else if (cmd == "WRITE") {
+		String name = cp_shift_spacevec(rest);
+		do_write(name, rest, out);
+	} else if (cmd == "WRITEDATA" && c) {
+		int n;
+		c->write_handler = cp_shift_spacevec(rest);
+		if (!IntArg().parse(cp_shift_spacevec(rest), n) || n < 0) {
+			out << CSERR_SYNTAX << " Syntax error in 'WRITEDATA'\r\n";
+			return 0;
+		}
+		if (n > CONTROL_MAX_DATA) {
+			out << CSERR_DATA_TOO_BIG << " Data too big\r\n";
+			return -1;
+		}
+		/* no payload to wait for */
+		if (n == 0)
+			do_write(c->write_handler, String(), out);
+		c->want = n;
+	} else if (cmd == "CHECKREAD")
+		do_check(cp_shift_spacevec(rest), false, out);
+	else if (cmd == "CHECKWRITE")
+		do_check(cp_shift_spacevec(rest), true, out);
+	else if (cmd == "QUIT") {
+		out << CSERR_OK << " Goodbye!\r\n";
+		return -1;
+	} else
+		out << CSERR_UNIMPLEMENTED << " Command '" << cmd
+		    << "' unimplemented\r\n";
+	return 0;
+}
+
+/* Consumes complete lines (and WRITEDATA payloads) from c->in. Returns -1
+ * if the connection should be closed.
+ */
+static int
+process_input(struct control_client *c, StringAccum &out)
+{
+	const char *p = c->in.begin(), *end = c->in.end(), *nl;
+	int r = 0;
+
+	while (p < end && r == 0) {
+		if (c->want) {
+			if (end - p < c->want)
+				break;
+			/* The payload can be a whole route table: hand it over
+			 * as part of the input buffer rather than copying it.
+			 */
+			int off = p - c->in.begin();
+			String in = c->in.take_string();
+			do_write(c->write_handler, in.substring(off, c->want), out);
+			c->in << in.substring(off + c->want);
+			c->want = 0;
+			p = c->in.begin();
+			end = c->in.end();
+			continue;
+		}
+		for (nl = p; nl < end && *nl != '\n'; ++nl)
+			/* nada */;
+		if (nl == end) {
+			if (end - p > CONTROL_MAX_LINE) {
+				out << CSERR_SYNTAX << " Line too long\r\n";
+				r = -1;
+			}
+			break;
+		}
+		const char *eol = (nl > p && nl[-1] == '\r') ? nl - 1 : nl;
+		r = do_command(c, String(p, eol - p), out);
+		p = nl + 1;
+	}
+	if (p != c->in.begin()) {
+		String left(p, end - p);
+		c->in.clear();
+		c->in << left;
+	}
+	return r;
+}
+
+static int
+write_all(int fd, const char *data, int len)
+{
+	while (len > 0) {
+		ssize_t n = write(fd, data, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		data += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static void
+close_client(struct control_client *c)
+{
+	close(c->fd);
+	c->fd = -1;
+	c->in.clear();
+	c->want = 0;
+}
+
+static void
+accept_client()
+{
+	int fd = accept(tcp_fd, NULL, NULL);
+
+	if (fd < 0)
+		return;
+	for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i)
+		if (clients[i].fd < 0) {
+			clients[i].fd = fd;
+			write_all(fd, CONTROL_BANNER, strlen(CONTROL_BANNER));
+			return;
+		}
+	uk_pr_warn("control: too many clients, dropping connection\n");
+	close(fd);
+}
+
+static void
+serve_client(struct control_client *c)
+{
+	char buf[2048];
+	ssize_t n = read(c->fd, buf, sizeof(buf));
+	StringAccum out;
+
+	if (n <= 0) {
+		close_client(c);
+		return;
+	}
+	c->in.append(buf, n);
+	if (process_input(c, out) < 0) {
+		write_all(c->fd, out.data(), out.length());
+		close_client(c);
+	} else if (out.length() && write_all(c->fd, out.data(), out.length()) < 0)
+		close_client(c);
+}
+
+static void
+serve_datagram()
+{
+	/* largest UDP payload over IPv4 */
+	static char buf[65507];
+	struct sockaddr_in from;
+	socklen_t fromlen = sizeof(from);
+	ssize_t n = recvfrom(udp_fd, buf, sizeof(buf), 0,
+			     (struct sockaddr *) &from, &fromlen);
+	struct control_client c;
+	StringAccum out;
+
+	if (n <= 0)
+		return;
+	c.fd = -1;
+	c.want = 0;
+	c.in.append(buf, n);
+	/* a last line without newline is still a command */
+	if (buf[n - 1] != '\n')
+		c.in << '\n';
+	process_input(&c, out);
+	if (out.length() > (int) sizeof(buf))
+		out.adjust_length(sizeof(buf) - out.length());
+	sendto(udp_fd, out.data(), out.length(), 0,
+	       (struct sockaddr *) &from, fromlen);
+}
+
+static int
+open_socket(int type)
+{
+	struct sockaddr_in sa;
+	int fd, one = 1;
+
+	if ((fd = socket(AF_INET, type, 0)) < 0)
+		return -errno;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(CONFIG_LIBCLICK_CONTROL_PORT);
+	sa.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0
+	    || (type == SOCK_STREAM && listen(fd, CONTROL_MAX_CLIENTS) < 0)) {
+		int err = -errno;
+		close(fd);
+		return err;
+	}
+	return fd;
+}
+
+static void
+control_thread(void *)
+{
+	struct pollfd pfd[CONTROL_MAX_CLIENTS + 2];
+
+	for (;;) {
+		int n = 0;
+
+		pfd[n].fd = tcp_fd;
+		pfd[n++].events = POLLIN;
+		if (udp_fd >= 0) {
+			pfd[n].fd = udp_fd;
+			pfd[n++].events = POLLIN;
+		}
+		for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) {
+			pfd[n].fd = clients[i].fd;
+			pfd[n++].events = POLLIN;
+		}
+
+		if (poll(pfd, n, -1) < 0) {
+			if (errno != EINTR)
+				uk_sched_yield();
+			continue;
+		}
+
+		n = 0;
+		if (pfd[n++].revents & POLLIN)
+			accept_client();
+		if (udp_fd >= 0 && (pfd[n++].revents & POLLIN))
+			serve_datagram();
+		for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i, ++n)
+			if (clients[i].fd >= 0
+			    && (pfd[n].revents & (POLLIN | POLLHUP | POLLERR)))
+				serve_client(&clients[i]);
+
+		/* Let the router run before answering the next batch */
+		uk_sched_yield();
+	}
+}
+
+int
+click_control_init(ErrorHandler *errh)
+{
+	struct uk_netdev *dev = uk_netdev_get(CONFIG_LIBCLICK_CONTROL_NETDEV);
+	ip4_addr_t addr, mask, gw;
+	struct netif *nf;
+
+	if (!dev)
+		return errh->error("control: no netdev %d",
+				   CONFIG_LIBCLICK_CONTROL_NETDEV);
+	if (!ip4addr_aton(CONFIG_LIBCLICK_CONTROL_IPV4_ADDR, &addr)
+	    || !ip4addr_aton(CONFIG_LIBCLICK_CONTROL_IPV4_NETMASK, &mask))
+		return errh->error("control: bad IPv4 address or netmask");
+	if (!ip4addr_aton(CONFIG_LIBCLICK_CONTROL_IPV4_GW, &gw))
+		ip4_addr_set_zero(&gw);
+
+	/* Once lwIP has configured the device, NetDevice refuses to touch
+	 * it.
+	 */
+	nf = uknetdev_addif(dev, &addr, &mask, &gw);
+	if (!nf)
+		return errh->error("control: failed to attach netdev %d to lwIP",
+				   CONFIG_LIBCLICK_CONTROL_NETDEV);
+	netif_set_default(nf);
+	netif_set_up(nf);
+	uk_pr_info("control: netdev %d is %s, port %d\n",
+		   CONFIG_LIBCLICK_CONTROL_NETDEV,
+		   CONFIG_LIBCLICK_CONTROL_IPV4_ADDR,
+		   CONFIG_LIBCLICK_CONTROL_PORT);
+	return 0;
+}
+
+int
+click_control_start(Router *r, ErrorHandler *errh)
+{
+	static struct uk_thread *thread;
+
+	control_router = r;
+	if (thread)
+		return 0;
+
+	for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i)
+		clients[i].fd = -1;
+	if ((tcp_fd = open_socket(SOCK_STREAM)) < 0)
+		return errh->error("control: TCP socket: %s", strerror(-tcp_fd));
+#if CONFIG_LIBCLICK_CONTROL_UDP
+	if ((udp_fd = open_socket(SOCK_DGRAM)) < 0)
+		return errh->error("control: UDP socket: %s", strerror(-udp_fd));
+#endif
+
+	thread = uk_sched_thread_create(uk_sched_current(), control_thread,
+					NULL, "click-control");
+	if (!thread)
+		return errh->error("control: cannot create thread");
+
+#if CONFIG_LIBCLICK_CONTROL_YIELD_MS
+	yield_timer.assign(yield_hook, 0);
+	yield_timer.initialize(r);
+	yield_timer.schedule_after_msec(CONFIG_LIBCLICK_CONTROL_YIELD_MS);
+#endif
+	return 0;
+}
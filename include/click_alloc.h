@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Size-class allocator behind Click's operator new/delete, and memory
+ * accounting by category (LIBCLICK_MEMSTATS), see alloc.cc
+ */
+
+#ifndef CLICK_ALLOC_H
+#define CLICK_ALLOC_H
+
+#include <stddef.h>
+
+#if CONFIG_LIBCLICK_MEMSTATS
+#include <uk/netbuf.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Click's glue.cc is compiled with malloc & co. renamed to these */
+void *click_malloc(size_t size);
+void *click_calloc(size_t nmemb, size_t size);
+void *click_realloc(void *ptr, size_t size);
+void click_free(void *ptr);
+
+/* What memory is charged to. Heap blocks are charged to the category of
+ * the allocating thread (see ClickMemScope), netbufs explicitly.
+ */
+enum click_mem_cat {
+	CLICK_MEM_OTHER,	/* main and control threads */
+	CLICK_MEM_ELEMENTS,	/* setting up the router */
+	CLICK_MEM_TABLES,	/* lookup and flow tables */
+	CLICK_MEM_PACKETS,	/* router threads at run time, mostly packets */
+	CLICK_MEM_NETBUFS,	/* device buffers */
+	CLICK_MEM_NCATS
+};
+
+#if CONFIG_LIBCLICK_MEMSTATS
+extern __thread int click_mem_cat;
+
+void click_mem_add(int cat, long bytes);
+void click_mem_netbuf_dtor(struct uk_netbuf *nb);
+
+/* Netbufs count from allocation until the destructor runs */
+#define CLICK_MEM_NETBUF_DTOR	click_mem_netbuf_dtor
+
+static inline void
+click_mem_netbuf_alloc(struct uk_netbuf *nb)
+{
+	click_mem_add(CLICK_MEM_NETBUFS, (long) (nb->buflen + sizeof(*nb)));
+}
+#else
+#define CLICK_MEM_NETBUF_DTOR	NULL
+
+static inline void click_mem_add(int cat, long bytes) { (void) cat; (void) bytes; }
+#define click_mem_netbuf_alloc(nb) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+
+/* Registers the global alloc_stats and memory handlers; call after
+ * click_static_initialize()
+ */
+void click_alloc_init();
+
+/* Charges the calling thread's heap allocations to cat until the end of
+ * the scope.
+ */
+class ClickMemScope {
+  public:
+#if CONFIG_LIBCLICK_MEMSTATS
+    ClickMemScope(int cat) : _old(click_mem_cat) { click_mem_cat = cat; }
+    ~ClickMemScope() { click_mem_cat = _old; }
+
+  private:
+    int _old;
+#else
+    ClickMemScope(int) { }
+#endif
+};
+#endif
+
+#endif /* CLICK_ALLOC_H */
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Queue layout Click sets up on its network devices */
+
+#ifndef CLICK_NETDEV_H
+#define CLICK_NETDEV_H
+
+#include <uk/netdev.h>
+
+#ifndef CONFIG_LIBCLICK_NTHREADS
+#define CONFIG_LIBCLICK_NTHREADS 1
+#endif
+
+/* Defaults of NetDevice and ToDevice, see Config.uk */
+#ifndef CONFIG_LIBCLICK_RX_RING
+#define CONFIG_LIBCLICK_RX_RING 256
+#endif
+#ifndef CONFIG_LIBCLICK_TX_RING
+#define CONFIG_LIBCLICK_TX_RING 256
+#endif
+#ifndef CONFIG_LIBCLICK_RX_BUFSIZE
+#define CONFIG_LIBCLICK_RX_BUFSIZE 2048
+#endif
+#ifndef CONFIG_LIBCLICK_TX_STAGE
+#define CONFIG_LIBCLICK_TX_STAGE 256
+#endif
+
+/* One TX queue per router thread, as far as the device has them; threads
+ * beyond that share queues (see ToDevice).
+ */
+static inline uint16_t
+click_netdev_tx_queues(const struct uk_netdev_info *info)
+{
+	uint16_t n = CONFIG_LIBCLICK_NTHREADS;
+
+	if (info->max_tx_queues && info->max_tx_queues < n)
+		n = info->max_tx_queues;
+	return n ? n : 1;
+}
+
+#endif /* CLICK_NETDEV_H */
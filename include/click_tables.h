@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Binary route tables, for loading large tables without parsing text.
+ * Written by support/scripts/click-mktable; read by Dir248IPLookup and
+ * PoptrieIP6Lookup from an initrd member (TABLE keyword) or their "load"
+ * write handler.
+ *
+ * A table is a header followed by count fixed-size entries. All integers
+ * are big-endian and the file has no alignment requirements.
+ */
+
+#ifndef CLICK_TABLES_H
+#define CLICK_TABLES_H
+
+#include <stdint.h>
+
+#define CLICK_TABLE_MAGIC_IP4	"CKR4"
+#define CLICK_TABLE_MAGIC_IP6	"CKR6"
+
+struct click_table_hdr {
+	char magic[4];
+	uint8_t count[4];
+};
+
+struct click_route4 {
+	uint8_t addr[4];
+	uint8_t gw[4];		/* 0.0.0.0: none */
+	uint8_t prefix_len;
+	uint8_t pad;
+	uint8_t port[2];
+};
+
+struct click_route6 {
+	uint8_t addr[16];
+	uint8_t gw[16];		/* ::: none */
+	uint8_t prefix_len;
+	uint8_t pad;
+	uint8_t port[2];
+};
+
+static inline uint32_t
+click_table_be32(const uint8_t *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+		| ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline uint16_t
+click_table_be16(const uint8_t *p)
+{
+	return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+/* Checks magic and length; returns the number of entries or -1 */
+static inline long
+click_table_count(const void *data, unsigned long len, const char *magic,
+		  unsigned long entry_size)
+{
+	const struct click_table_hdr *h = (const struct click_table_hdr *) data;
+	uint32_t n;
+
+	if (len < sizeof(*h) || h->magic[0] != magic[0]
+	    || h->magic[1] != magic[1] || h->magic[2] != magic[2]
+	    || h->magic[3] != magic[3])
+		return -1;
+	n = click_table_be32(h->count);
+	if ((len - sizeof(*h)) / entry_size != n
+	    || (len - sizeof(*h)) % entry_size)
+		return -1;
+	return n;
+}
+
+#ifdef __cplusplus
+#include <click/string.hh>
+#include <uk/sched.h>
+
+/* Tables are loaded by the control thread and the scheduler is
+ * cooperative, so loading gives the CPU to the router threads every
+ * CLICK_TABLE_YIELD routes to keep forwarding meanwhile.
+ */
+#define CLICK_TABLE_YIELD	4096
+
+static inline void
+click_table_yield(long i)
+{
+	if (i % CLICK_TABLE_YIELD == CLICK_TABLE_YIELD - 1)
+		uk_sched_yield();
+}
+
+/* Finds member name of the initrd if it is an ar archive; the data stays
+ * in the initrd. See get_config() in click.cc.
+ */
+bool click_initrd_member(const String &name, String &data);
+
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+/* Compares PoptrieIP6Lookup with Click's IP6Table on a generated table and
+ * prints the cycles per lookup of both; returns the number of mismatches.
+ */
+int click_lookup_selftest(void);
+#endif
+#if CONFIG_LIBCLICK_FLOWTABLE_SELFTEST
+/* Compares CuckooFlowTable with Click's HashTable under random updates
+ * and prints the cycles per lookup of both; returns the number of
+ * mismatches.
+ */
+int click_flowtable_selftest(void);
+#endif
+#endif
+
+#endif /* CLICK_TABLES_H */
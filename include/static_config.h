@@ -1,9 +1,14 @@
+/* The fallback configuration. BatchClassifier takes batches from
+ * FromDevice at once, but click-fastclassifier (LIBCLICK_SPECIALIZE) only
+ * compiles Classifier, IPClassifier and IPFilter: a specialized build of
+ * this configuration keeps the generic classifier.
+ */
 static char CONFIGSTRING[] = "    define($IP 10.0.10.123);\n\
 \n\
     source :: FromDevice;\n\
-    sink   :: ToDevice;\n\
+    sink   :: ToDevice; // input 0 has priority over input 1\n\
     // classifies packets \n\
-    c :: Classifier(\n\
+    c :: BatchClassifier(\n\
         12/0806 20/0001, // ARP Requests goes to output 0\n\
         12/0806 20/0002, // ARP Replies to output 1\n\
         12/0800 14/45 34/08, // ICMP Requests to output 2\n\
@@ -13,9 +18,9 @@ static char CONFIGSTRING[] = "    define($IP 10.0.10.123);\n\
     arpr :: ARPResponder($IP $MAC0);\n\
 \n\
     source -> c;\n\
-    c[0] -> CheckARPHeader(14) -> ARPPrint -> arpr -> ARPPrint -> sink;\n\
+    c[0] -> CheckARPHeader(14) -> ARPPrint -> arpr -> ARPPrint -> [0]sink;\n\
     c[1] -> [1]arpq;\n\
     Idle -> [0]arpq;\n\
-    arpq -> sink;\n\
-    c[2] -> CheckIPHeader(14) -> IPPrint -> ICMPPingResponder() -> EtherMirror() -> IPPrint -> sink;\n\
+    arpq -> [1]sink;\n\
+    c[2] -> BatchCheckIPHeader(14) -> IPPrint -> ICMPPingResponder() -> BatchEtherMirror() -> IPPrint -> [1]sink;\n\
     c[3] -> Discard;";
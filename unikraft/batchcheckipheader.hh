@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_BATCHCHECKIPHEADER_HH
+#define CLICK_BATCHCHECKIPHEADER_HH
+
+#include <click/config.h>
+#include "elements/ip/checkipheader.hh"
+#include "batchelement.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+BatchCheckIPHeader([OFFSET, I<keywords>])
+
+=s ip
+
+CheckIPHeader with a batch path
+
+=d
+
+Same as CheckIPHeader, taking the same arguments, but works through whole
+batches from batch-capable neighbours and hands the valid packets on as one
+batch. Invalid packets still leave one by one on the optional second
+output.
+
+=a CheckIPHeader, BatchElement
+*/
+
+class BatchCheckIPHeader : public BatchElementBase<CheckIPHeader> { public:
+
+    BatchCheckIPHeader();
+
+    const char *class_name() const	{ return "BatchCheckIPHeader"; }
+
+    void push_batch(int, PacketBatch &);
+    void pull_batch(int, unsigned, PacketBatch &);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,320 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_BATCHELEMENT_HH
+#define CLICK_BATCHELEMENT_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/packet.hh>
+#include <click/vector.hh>
+#if CLICK_STATS >= 2
+#include <click/cycles.hh>
+#endif
+
+CLICK_DECLS
+
+#if CLICK_STATS >= 1
+/* The packet counter of port, which Element::Port::push() and pull()
+ * keep up to date and batch edges bypass (see batchelement.cc) */
+unsigned &batch_port_packets(const Element::Port &port);
+#endif
+
+/** @class PacketBatch
+ * @brief A list of packets handed between elements in one call.
+ *
+ * Packets are linked through their next() annotation, so building and
+ * splitting batches allocates nothing. A packet belongs to at most one
+ * batch; pop_front() clears its link before handing it out.
+ */
+class PacketBatch { public:
+
+    PacketBatch()
+	: _head(0), _tail(0), _count(0) {
+    }
+
+    Packet *first() const		{ return _head; }
+    unsigned count() const		{ return _count; }
+    bool empty() const			{ return !_head; }
+
+    inline void append(Packet *p);
+    inline void append(PacketBatch &b);
+    inline Packet *pop_front();
+    void clear()			{ _head = _tail = 0; _count = 0; }
+    inline void kill();
+
+  private:
+
+    Packet *_head;
+    Packet *_tail;
+    unsigned _count;
+
+};
+
+inline void
+PacketBatch::append(Packet *p)
+{
+    p->set_next(0);
+    if (_tail)
+	_tail->set_next(p);
+    else
+	_head = p;
+    _tail = p;
+    ++_count;
+}
+
+inline void
+PacketBatch::append(PacketBatch &b)
+{
+    if (b._head) {
+	if (_tail)
+	    _tail->set_next(b._head);
+	else
+	    _head = b._head;
+	_tail = b._tail;
+	_count += b._count;
+	b.clear();
+    }
+}
+
+inline Packet *
+PacketBatch::pop_front()
+{
+    Packet *p = _head;
+
+    if (p) {
+	_head = p->next();
+	if (!_head)
+	    _tail = 0;
+	--_count;
+	p->set_next(0);
+    }
+    return p;
+}
+
+inline void
+PacketBatch::kill()
+{
+    while (Packet *p = pop_front())
+	p->kill();
+}
+
+/** @class BatchTarget
+ * @brief What batch-capable elements offer their neighbours.
+ *
+ * BatchElementBase<E>::cast("BatchElement") returns this interface, so
+ * neighbours find batch support whatever Click class the element derives
+ * from.
+ */
+class BatchTarget { public:
+
+    virtual void push_batch(int port, PacketBatch &batch) = 0;
+    virtual void pull_batch(int port, unsigned max, PacketBatch &batch) = 0;
+
+  protected:
+
+    ~BatchTarget() { }
+
+};
+
+/** @class BatchElementBase
+ * @brief Element that can receive and emit whole batches of packets.
+ *
+ * A batch pushed out of a port reaches a batch-capable element behind it
+ * in a single push_batch() call; any other element gets the packets one by
+ * one through push(). Likewise pull_batch() on an input asks a
+ * batch-capable element upstream for many packets at once and falls back
+ * to calling pull().
+ *
+ * The defaults of push_batch() and pull_batch() do the same per-packet
+ * work, so a subclass only needs to override them where handling a batch
+ * at once is cheaper. Subclasses overriding initialize() must call the
+ * base's initialize(), which looks up the batch-capable neighbours.
+ *
+ * E is the Click class to extend, Element for new elements (see
+ * BatchElement) or an existing element to give it batch paths.
+ */
+template <typename E>
+class BatchElementBase : public E, public BatchTarget { public:
+
+    BatchElementBase() { }
+
+    void *cast(const char *);
+    int initialize(ErrorHandler *);
+
+    void push_batch(int port, PacketBatch &batch);
+    void pull_batch(int port, unsigned max, PacketBatch &batch);
+
+    inline void output_push_batch(int port, PacketBatch &batch);
+    inline void input_pull_batch(int port, unsigned max, PacketBatch &batch);
+    inline void checked_output_push_batch(int port, PacketBatch &batch);
+
+  private:
+
+    Vector<BatchTarget *> _out_batch;
+    Vector<BatchTarget *> _in_batch;
+
+};
+
+typedef BatchElementBase<Element> BatchElement;
+
+template <typename E>
+void *
+BatchElementBase<E>::cast(const char *n)
+{
+    if (strcmp(n, "BatchElement") == 0)
+	return static_cast<BatchTarget *>(this);
+    return E::cast(n);
+}
+
+template <typename E>
+int
+BatchElementBase<E>::initialize(ErrorHandler *errh)
+{
+    if (E::initialize(errh) < 0)
+	return -1;
+    _out_batch.assign(this->noutputs(), 0);
+    for (int i = 0; i < this->noutputs(); ++i)
+	if (this->output_is_push(i) && this->output(i).element())
+	    _out_batch[i] = static_cast<BatchTarget *>(
+		this->output(i).element()->cast("BatchElement"));
+    _in_batch.assign(this->ninputs(), 0);
+    for (int i = 0; i < this->ninputs(); ++i)
+	if (this->input_is_pull(i) && this->input(i).element())
+	    _in_batch[i] = static_cast<BatchTarget *>(
+		this->input(i).element()->cast("BatchElement"));
+    return 0;
+}
+
+template <typename E>
+void
+BatchElementBase<E>::push_batch(int port, PacketBatch &batch)
+{
+    while (Packet *p = batch.pop_front())
+	this->push(port, p);
+}
+
+template <typename E>
+void
+BatchElementBase<E>::pull_batch(int port, unsigned max, PacketBatch &batch)
+{
+    for (unsigned i = 0; i < max; ++i) {
+	Packet *p = this->pull(port);
+	if (!p)
+	    break;
+	batch.append(p);
+    }
+}
+
+/** @brief Push all packets of @a batch out of output @a port.
+ *
+ * @a batch is empty afterwards. */
+template <typename E>
+inline void
+BatchElementBase<E>::output_push_batch(int port, PacketBatch &batch)
+{
+    BatchTarget *next = _out_batch[port];
+
+    if (batch.empty())
+	return;
+    if (next) {
+	/* the accounting of Port::push(): packets, and calls and own
+	 * cycles of the element pushed to */
+#if CLICK_STATS >= 1
+	Element *e = this->output(port).element();
+	batch_port_packets(e->input(this->output(port).port())) += batch.count();
+#endif
+#if CLICK_STATS >= 2
+	click_cycles_t start = click_get_cycles(), child = e->_child_cycles;
+#endif
+	next->push_batch(this->output(port).port(), batch);
+#if CLICK_STATS >= 2
+	click_cycles_t all = click_get_cycles() - start;
+	e->_xfer_calls += 1;
+	e->_xfer_own_cycles += all - (e->_child_cycles - child);
+	this->_child_cycles += all;
+#endif
+    } else
+	while (Packet *p = batch.pop_front())
+	    this->output(port).push(p);
+    batch.clear();
+}
+
+/** @brief Like output_push_batch(), but kills the packets if output @a
+ * port does not exist. */
+template <typename E>
+inline void
+BatchElementBase<E>::checked_output_push_batch(int port, PacketBatch &batch)
+{
+    if ((unsigned) port < (unsigned) this->noutputs())
+	output_push_batch(port, batch);
+    else
+	batch.kill();
+}
+
+/** @brief Pull up to @a max packets from input @a port, appending them to
+ * @a batch. */
+template <typename E>
+inline void
+BatchElementBase<E>::input_pull_batch(int port, unsigned max, PacketBatch &batch)
+{
+    BatchTarget *prev = _in_batch[port];
+
+    if (prev) {
+	/* the accounting of Port::pull() */
+#if CLICK_STATS >= 1
+	Element *e = this->input(port).element();
+	unsigned n = batch.count();
+#endif
+#if CLICK_STATS >= 2
+	click_cycles_t start = click_get_cycles(), child = e->_child_cycles;
+#endif
+	prev->pull_batch(this->input(port).port(), max, batch);
+#if CLICK_STATS >= 2
+	click_cycles_t all = click_get_cycles() - start;
+	e->_xfer_calls += 1;
+	e->_xfer_own_cycles += all - (e->_child_cycles - child);
+	this->_child_cycles += all;
+#endif
+#if CLICK_STATS >= 1
+	batch_port_packets(e->output(this->input(port).port())) += batch.count() - n;
+#endif
+    } else
+	for (unsigned i = 0; i < max; ++i) {
+	    Packet *p = this->input(port).pull();
+	    if (!p)
+		break;
+	    batch.append(p);
+	}
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,622 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_CUCKOOFLOWTABLE_HH
+#define CLICK_CUCKOOFLOWTABLE_HH
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/hashcode.hh>
+#include <click/vector.hh>
+#include <click_alloc.h>
+#include <new>
+#include <string.h>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+CLICK_DECLS
+
+/** @class CuckooFlowTable
+ * @brief Bucketized cuckoo hash table for flow state.
+ *
+ * Maps keys such as IPFlowID or IP6FlowID to values; K needs operator== and
+ * a hashcode(). Every key lives in one of two buckets of eight slots. A
+ * bucket holds a 16-bit tag per slot, compared all at once with SSE2 or
+ * NEON, and the index of the entry, so a lookup reads at most two cache
+ * lines of buckets plus the matching entry.
+ *
+ * Entries are allocated in chunks and never move, so pointers returned by
+ * find() and find_insert() stay valid until the entry is erased. Growing
+ * allocates a bucket array twice the size and then moves a few old buckets
+ * on every insert and erase; lookups check both arrays until the move is
+ * done. Callers that mostly look up should call resize_step() from a task
+ * or timer while resizing() is true.
+ *
+ * find_burst() hashes a burst of keys and prefetches all their buckets
+ * before probing any of them.
+ *
+ * Like HashTable, the table is not safe for concurrent writers.
+ */
+template <typename K, typename V>
+class CuckooFlowTable { public:
+
+    typedef K key_type;
+    typedef V mapped_type;
+
+    enum { SLOTS = 8, BURST_MAX = 32 };
+
+    explicit CuckooFlowTable(uint32_t initial_buckets = 256);
+    ~CuckooFlowTable();
+
+    size_t size() const			{ return _size; }
+    bool empty() const			{ return _size == 0; }
+    uint32_t bucket_count() const	{ return _t.mask + 1; }
+    bool resizing() const		{ return _o.b != 0; }
+
+    inline V *find(const K &key);
+    inline const V *find(const K &key) const;
+    void find_burst(const K *keys, V **values, int n);
+
+    V *find_insert(const K &key, const V &value, bool *inserted = 0);
+    inline bool set(const K &key, const V &value);
+    bool erase(const K &key);
+    void clear();
+
+    void resize_step(int nbuckets = MIGRATE_STEP);
+
+    class iterator;
+    iterator begin()			{ return iterator(this); }
+
+  private:
+
+    struct entry {
+	K key;
+	V value;
+	entry(const K &k, const V &v) : key(k), value(v) { }
+    };
+
+    struct Bucket {
+	uint16_t tag[SLOTS];	// 0 marks a free slot
+	uint32_t idx[SLOTS];
+    } __attribute__((aligned(64)));
+
+    struct Table {
+	Bucket *b;
+	char *mem;
+	uint32_t mask;
+    };
+
+    enum {
+	CHUNK_SHIFT = 12, CHUNK = 1 << CHUNK_SHIFT,
+	MAX_KICKS = 256, STASH_MAX = 16, MIGRATE_STEP = 2
+    };
+
+    Table _t;			// inserts go here
+    Table _o;			// being moved into _t while b != 0
+    uint32_t _migrate;		// next _o bucket to move
+    size_t _size;
+    uint32_t _rng;
+
+    Vector<entry *> _chunks;
+    uint32_t _nentries;		// entries handed out, including freed
+    Vector<uint32_t> _freelist;
+    Vector<uint32_t> _stash;	// entries no bucket had room for
+
+    entry *at(uint32_t i) const {
+	return &_chunks[i >> CHUNK_SHIFT][i & (CHUNK - 1)];
+    }
+
+    static inline uint64_t hash(const K &key) {
+	uint64_t x = hashcode(key);
+	x ^= x >> 33;
+	x *= 0xFF51AFD7ED558CCDULL;
+	x ^= x >> 33;
+	x *= 0xC4CEB9FE1A85EC53ULL;
+	return x ^ (x >> 33);
+    }
+    static inline uint16_t tag_of(uint64_t h) {
+	uint16_t t = h >> 48;
+	return t ? t : 1;
+    }
+    static inline uint32_t alt(uint32_t b, uint16_t tag, uint32_t mask) {
+	return (b ^ (tag * 0x5BD1E995U)) & mask;
+    }
+
+    static inline uint64_t match(const Bucket *b, uint16_t tag);
+    static inline int match_slot(uint64_t m);
+
+    static bool alloc_table(Table &, uint32_t nbuckets);
+    static void free_table(Table &);
+
+    entry *probe(const Table &, uint32_t b, uint16_t tag, const K &,
+		 int *slot = 0) const;
+    entry *lookup(uint64_t h, const K &) const;
+    bool place(Table &, uint64_t h, uint32_t idx, uint32_t &homeless);
+    void place_or_stash(uint32_t idx);
+    uint32_t alloc_entry(const K &, const V &);
+    void free_entry(uint32_t idx);
+    void grow();
+    void migrate_bucket(uint32_t b);
+
+    CuckooFlowTable(const CuckooFlowTable<K, V> &);
+    CuckooFlowTable<K, V> &operator=(const CuckooFlowTable<K, V> &);
+
+    friend class iterator;
+
+};
+
+template <typename K, typename V>
+class CuckooFlowTable<K, V>::iterator { public:
+    bool live() const		{ return _e != 0; }
+    const K &key() const		{ return _e->key; }
+    V &value() const		{ return _e->value; }
+    void operator++()		{ ++_pos; advance(); }
+    void operator++(int)		{ ++*this; }
+  private:
+    CuckooFlowTable<K, V> *_h;
+    uint32_t _pos;
+    entry *_e;
+    iterator(CuckooFlowTable<K, V> *h) : _h(h), _pos(0), _e(0) { advance(); }
+    void advance();
+    friend class CuckooFlowTable<K, V>;
+};
+
+/* Returns a mask with one bit set per slot whose tag equals @tag;
+ * match_slot() turns its lowest set bit back into a slot number. */
+template <typename K, typename V>
+inline uint64_t
+CuckooFlowTable<K, V>::match(const Bucket *b, uint16_t tag)
+{
+#if defined(__SSE2__)
+    __m128i t = _mm_load_si128((const __m128i *) b->tag);
+    __m128i m = _mm_cmpeq_epi16(t, _mm_set1_epi16(tag));
+    return _mm_movemask_epi8(m) & 0x5555;
+#elif defined(__ARM_NEON)
+    uint16x8_t m = vceqq_u16(vld1q_u16(b->tag), vdupq_n_u16(tag));
+    return vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(m)), 0)
+	& 0x0101010101010101ULL;
+#else
+    uint64_t m = 0;
+    for (int i = 0; i < SLOTS; ++i)
+	m |= (uint64_t) (b->tag[i] == tag) << i;
+    return m;
+#endif
+}
+
+template <typename K, typename V>
+inline int
+CuckooFlowTable<K, V>::match_slot(uint64_t m)
+{
+#if defined(__SSE2__)
+    return __builtin_ctzll(m) >> 1;
+#elif defined(__ARM_NEON)
+    return __builtin_ctzll(m) >> 3;
+#else
+    return __builtin_ctzll(m);
+#endif
+}
+
+template <typename K, typename V>
+CuckooFlowTable<K, V>::CuckooFlowTable(uint32_t initial_buckets)
+    : _migrate(0), _size(0), _rng(0x2545F491), _nentries(0)
+{
+    uint32_t n = 1;
+    while (n < initial_buckets)
+	n <<= 1;
+    _o.b = 0;
+    _o.mem = 0;
+    _o.mask = 0;
+    if (!alloc_table(_t, n))
+	alloc_table(_t, 1);
+}
+
+template <typename K, typename V>
+CuckooFlowTable<K, V>::~CuckooFlowTable()
+{
+    clear();
+    free_table(_t);
+    for (int i = 0; i < _chunks.size(); ++i)
+	delete[] reinterpret_cast<char *>(_chunks[i]);
+}
+
+template <typename K, typename V>
+bool
+CuckooFlowTable<K, V>::alloc_table(Table &t, uint32_t nbuckets)
+{
+    ClickMemScope mem(CLICK_MEM_TABLES);
+
+    t.mem = new char[nbuckets * sizeof(Bucket) + 63];
+    if (!t.mem) {
+	t.b = 0;
+	return false;
+    }
+    t.b = reinterpret_cast<Bucket *>(((uintptr_t) t.mem + 63) & ~(uintptr_t) 63);
+    t.mask = nbuckets - 1;
+    memset(t.b, 0, nbuckets * sizeof(Bucket));
+    return true;
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::free_table(Table &t)
+{
+    delete[] t.mem;
+    t.b = 0;
+    t.mem = 0;
+    t.mask = 0;
+}
+
+template <typename K, typename V>
+typename CuckooFlowTable<K, V>::entry *
+CuckooFlowTable<K, V>::probe(const Table &t, uint32_t b, uint16_t tag,
+			     const K &key, int *slot) const
+{
+    const Bucket *bk = &t.b[b];
+
+    for (uint64_t m = match(bk, tag); m; m &= m - 1) {
+	int s = match_slot(m);
+	entry *e = at(bk->idx[s]);
+	if (e->key == key) {
+	    if (slot)
+		*slot = s;
+	    return e;
+	}
+    }
+    return 0;
+}
+
+template <typename K, typename V>
+typename CuckooFlowTable<K, V>::entry *
+CuckooFlowTable<K, V>::lookup(uint64_t h, const K &key) const
+{
+    uint16_t tag = tag_of(h);
+    uint32_t b = h & _t.mask;
+    entry *e;
+
+    if ((e = probe(_t, b, tag, key))
+	|| (e = probe(_t, alt(b, tag, _t.mask), tag, key)))
+	return e;
+    if (unlikely(_o.b)) {
+	b = h & _o.mask;
+	if ((e = probe(_o, b, tag, key))
+	    || (e = probe(_o, alt(b, tag, _o.mask), tag, key)))
+	    return e;
+    }
+    for (int i = 0; unlikely(i < _stash.size()); ++i)
+	if (at(_stash[i])->key == key)
+	    return at(_stash[i]);
+    return 0;
+}
+
+template <typename K, typename V>
+inline V *
+CuckooFlowTable<K, V>::find(const K &key)
+{
+    entry *e = lookup(hash(key), key);
+    return e ? &e->value : 0;
+}
+
+template <typename K, typename V>
+inline const V *
+CuckooFlowTable<K, V>::find(const K &key) const
+{
+    entry *e = lookup(hash(key), key);
+    return e ? &e->value : 0;
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::find_burst(const K *keys, V **values, int n)
+{
+    uint64_t h[BURST_MAX];
+
+    for (; n > 0; keys += BURST_MAX, values += BURST_MAX, n -= BURST_MAX) {
+	int m = n < BURST_MAX ? n : BURST_MAX;
+
+	for (int i = 0; i < m; ++i) {
+	    uint16_t tag;
+	    uint32_t b;
+
+	    h[i] = hash(keys[i]);
+	    tag = tag_of(h[i]);
+	    b = h[i] & _t.mask;
+	    __builtin_prefetch(&_t.b[b]);
+	    __builtin_prefetch(&_t.b[alt(b, tag, _t.mask)]);
+	    if (unlikely(_o.b)) {
+		b = h[i] & _o.mask;
+		__builtin_prefetch(&_o.b[b]);
+		__builtin_prefetch(&_o.b[alt(b, tag, _o.mask)]);
+	    }
+	}
+	for (int i = 0; i < m; ++i) {
+	    uint64_t mk = match(&_t.b[h[i] & _t.mask], tag_of(h[i]));
+	    if (mk)
+		__builtin_prefetch(at(_t.b[h[i] & _t.mask].idx[match_slot(mk)]));
+	}
+	for (int i = 0; i < m; ++i) {
+	    entry *e = lookup(h[i], keys[i]);
+	    values[i] = e ? &e->value : 0;
+	}
+    }
+}
+
+template <typename K, typename V>
+uint32_t
+CuckooFlowTable<K, V>::alloc_entry(const K &key, const V &value)
+{
+    uint32_t idx;
+
+    if (_freelist.size()) {
+	idx = _freelist.back();
+	_freelist.pop_back();
+    } else {
+	if ((_nentries >> CHUNK_SHIFT) == (uint32_t) _chunks.size()) {
+	    ClickMemScope mem(CLICK_MEM_TABLES);
+	    char *c = new char[CHUNK * sizeof(entry)];
+	    if (!c)
+		return (uint32_t) -1;
+	    _chunks.push_back(reinterpret_cast<entry *>(c));
+	}
+	idx = _nentries++;
+    }
+    new((void *) at(idx)) entry(key, value);
+    return idx;
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::free_entry(uint32_t idx)
+{
+    at(idx)->~entry();
+    _freelist.push_back(idx);
+}
+
+/* Puts entry @idx into one of its buckets in @t, kicking other entries to
+ * their alternate bucket as needed. On failure @homeless is the entry that
+ * was left without a slot, which need not be @idx. */
+template <typename K, typename V>
+bool
+CuckooFlowTable<K, V>::place(Table &t, uint64_t h, uint32_t idx,
+			     uint32_t &homeless)
+{
+    uint16_t tag = tag_of(h);
+    uint32_t b = h & t.mask;
+    uint64_t m;
+
+    for (int n = 0; n < MAX_KICKS; ++n) {
+	uint32_t b2 = alt(b, tag, t.mask);
+	if (!(m = match(&t.b[b], 0)) && (m = match(&t.b[b2], 0)))
+	    b = b2;
+	if (m) {
+	    int s = match_slot(m);
+	    t.b[b].tag[s] = tag;
+	    t.b[b].idx[s] = idx;
+	    return true;
+	}
+	/* Both buckets full: evict a pseudo-random slot and carry on with
+	 * the victim. Only the first eviction picks between the buckets;
+	 * later ones must not go back to where the victim came from. */
+	_rng = _rng * 1103515245 + 12345;
+	if (n == 0 && (_rng & 0x10000))
+	    b = b2;
+	int s = (_rng >> 17) & (SLOTS - 1);
+	uint16_t vt = t.b[b].tag[s];
+	uint32_t vi = t.b[b].idx[s];
+	t.b[b].tag[s] = tag;
+	t.b[b].idx[s] = idx;
+	tag = vt;
+	idx = vi;
+	b = alt(b, tag, t.mask);
+    }
+    homeless = idx;
+    return false;
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::place_or_stash(uint32_t idx)
+{
+    uint32_t homeless;
+
+    if (!place(_t, hash(at(idx)->key), idx, homeless))
+	_stash.push_back(homeless);
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::migrate_bucket(uint32_t b)
+{
+    Bucket *bk = &_o.b[b];
+
+    for (int s = 0; s < SLOTS; ++s)
+	if (bk->tag[s]) {
+	    place_or_stash(bk->idx[s]);
+	    bk->tag[s] = 0;
+	}
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::resize_step(int nbuckets)
+{
+    if (!_o.b)
+	return;
+    for (; nbuckets > 0 && _migrate <= _o.mask; --nbuckets)
+	migrate_bucket(_migrate++);
+    if (_migrate > _o.mask) {
+	Vector<uint32_t> stash;
+
+	free_table(_o);
+	_migrate = 0;
+	/* A larger table usually has room for the stragglers. */
+	stash.swap(_stash);
+	for (int i = 0; i < stash.size(); ++i)
+	    place_or_stash(stash[i]);
+    }
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::grow()
+{
+    Table t;
+
+    if (_o.b)		/* still moving: finish that first */
+	resize_step(_o.mask + 1);
+    if (!alloc_table(t, (_t.mask + 1) * 2))
+	return;
+    _o = _t;
+    _t = t;
+    _migrate = 0;
+}
+
+template <typename K, typename V>
+V *
+CuckooFlowTable<K, V>::find_insert(const K &key, const V &value,
+				   bool *inserted)
+{
+    uint64_t h = hash(key);
+    entry *e = lookup(h, key);
+    uint32_t idx, homeless;
+
+    if (inserted)
+	*inserted = !e;
+    if (e)
+	return &e->value;
+
+    if ((idx = alloc_entry(key, value)) == (uint32_t) -1) {
+	if (inserted)
+	    *inserted = false;
+	return 0;
+    }
+    if (!place(_t, h, idx, homeless))
+	_stash.push_back(homeless);
+    ++_size;
+
+    if (_size * 8 > (size_t) (_t.mask + 1) * SLOTS * 7
+	|| _stash.size() > STASH_MAX)
+	grow();
+    resize_step();
+    return &at(idx)->value;
+}
+
+template <typename K, typename V>
+inline bool
+CuckooFlowTable<K, V>::set(const K &key, const V &value)
+{
+    bool inserted;
+    V *v = find_insert(key, value, &inserted);
+
+    if (v && !inserted)
+	*v = value;
+    return v != 0;
+}
+
+template <typename K, typename V>
+bool
+CuckooFlowTable<K, V>::erase(const K &key)
+{
+    uint64_t h = hash(key);
+    uint16_t tag = tag_of(h);
+    Table *tabs[2] = { &_t, &_o };
+    uint32_t idx = (uint32_t) -1;
+
+    for (int i = 0; i < 2 && idx == (uint32_t) -1 && tabs[i]->b; ++i) {
+	Table &t = *tabs[i];
+	uint32_t bs[2] = { (uint32_t) (h & t.mask), 0 };
+	bs[1] = alt(bs[0], tag, t.mask);
+	for (int j = 0; j < 2; ++j) {
+	    int s;
+	    if (probe(t, bs[j], tag, key, &s)) {
+		idx = t.b[bs[j]].idx[s];
+		t.b[bs[j]].tag[s] = 0;
+		break;
+	    }
+	}
+    }
+    for (int i = 0; idx == (uint32_t) -1 && i < _stash.size(); ++i)
+	if (at(_stash[i])->key == key) {
+	    idx = _stash[i];
+	    _stash[i] = _stash.back();
+	    _stash.pop_back();
+	}
+    if (idx == (uint32_t) -1)
+	return false;
+
+    free_entry(idx);
+    --_size;
+    resize_step();
+    return true;
+}
+
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::clear()
+{
+    for (iterator it = begin(); it.live(); ++it)
+	it._e->~entry();
+    memset(_t.b, 0, (_t.mask + 1) * sizeof(Bucket));
+    free_table(_o);
+    _migrate = 0;
+    _stash.clear();
+    _freelist.clear();
+    _nentries = 0;
+    _size = 0;
+}
+
+/* Walks _t, then _o, then the stash. */
+template <typename K, typename V>
+void
+CuckooFlowTable<K, V>::iterator::advance()
+{
+    uint32_t nt = (_h->_t.mask + 1) * SLOTS;
+    uint32_t no = _h->_o.b ? (_h->_o.mask + 1) * SLOTS : 0;
+
+    for (; _pos < nt + no; ++_pos) {
+	const Table &t = _pos < nt ? _h->_t : _h->_o;
+	uint32_t p = _pos < nt ? _pos : _pos - nt;
+	const Bucket &b = t.b[p / SLOTS];
+	if (b.tag[p % SLOTS]) {
+	    _e = _h->at(b.idx[p % SLOTS]);
+	    return;
+	}
+    }
+    if (_pos - nt - no < (uint32_t) _h->_stash.size())
+	_e = _h->at(_h->_stash[_pos - nt - no]);
+    else
+	_e = 0;
+}
+
+CLICK_ENDDECLS
+#endif
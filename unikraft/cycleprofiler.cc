@@ -0,0 +1,243 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "cycleprofiler.hh"
+
+#include <click/args.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+CycleProfiler::CycleProfiler()
+{
+}
+
+int
+CycleProfiler::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	if (Args(conf, this, errh).complete() < 0)
+		return -1;
+#if CLICK_STATS < 2
+	return errh->error("Click was built without cycle accounting, "
+			   "set LIBCLICK_STATS to 2");
+#else
+	return 0;
+#endif
+}
+
+/* Click's "cycles" handler prints lines like "tasks 3 1200": calls and
+ * own cycles of tasks, timers and push/pull transfers ("xfer").
+ */
+void
+CycleProfiler::read_cycles(Element *e, bool xfer, uint64_t &calls, uint64_t &cycles)
+{
+	const Handler *h = Router::handler(e, "cycles");
+	Vector<String> words;
+	uint64_t n, c;
+
+	calls = cycles = 0;
+	if (!h || !h->readable())
+		return;
+	cp_spacevec(h->call_read(e).trim_space(), words);
+	for (int i = 0; i + 2 < words.size(); i += 3)
+		if ((xfer || words[i] != "xfer")
+		    && IntArg().parse(words[i + 1], n)
+		    && IntArg().parse(words[i + 2], c)) {
+			calls += n;
+			cycles += c;
+		}
+}
+
+/* "icounts" and "ocounts" print one packet count per port, or "??" */
+uint64_t
+CycleProfiler::read_counts(Element *e, const char *name)
+{
+	const Handler *h = Router::handler(e, name);
+	Vector<String> words;
+	uint64_t n, total = 0;
+
+	if (!h || !h->readable())
+		return 0;
+	cp_spacevec(h->call_read(e), words);
+	for (int i = 0; i < words.size(); ++i)
+		if (IntArg().parse(words[i], n))
+			total += n;
+	return total;
+}
+
+static int
+sample_compar(const void *a, const void *b, void *)
+{
+	uint64_t x = *static_cast<const uint64_t *>(a);
+	uint64_t y = *static_cast<const uint64_t *>(b);
+
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+void
+CycleProfiler::collect(Vector<Sample> &samples)
+{
+	Router *r = router();
+
+	samples.resize(r->nelements());
+	for (int i = 0; i < r->nelements(); ++i) {
+		Sample &s = samples[i];
+		s.e = r->element(i);
+		s.thread = s.e->home_thread_id();
+		read_cycles(s.e, true, s.calls, s.cycles);
+		s.packets = read_counts(s.e, s.e->ninputs() ? "icounts" : "ocounts");
+	}
+}
+
+/* Finds for every element the element that calls it on the shortest path
+ * from an element running tasks or timers: a breadth-first search along
+ * push outputs and pull inputs. Elements never reached get -1.
+ */
+void
+CycleProfiler::call_chains(Vector<int> &caller)
+{
+	Router *r = router();
+	Vector<int> queue;
+	uint64_t calls, cycles;
+
+	caller.assign(r->nelements(), -1);
+	for (int i = 0; i < r->nelements(); ++i) {
+		read_cycles(r->element(i), false, calls, cycles);
+		if (calls) {
+			caller[i] = i;
+			queue.push_back(i);
+		}
+	}
+
+	for (int q = 0; q < queue.size(); ++q) {
+		Element *e = r->element(queue[q]);
+		Vector<Element *> callees;
+
+		for (int p = 0; p < e->noutputs(); ++p)
+			if (e->output_is_push(p))
+				callees.push_back(e->output(p).element());
+		for (int p = 0; p < e->ninputs(); ++p)
+			if (e->input_is_pull(p))
+				callees.push_back(e->input(p).element());
+		for (int c = 0; c < callees.size(); ++c) {
+			int ci = callees[c] ? callees[c]->eindex() : -1;
+			if (ci >= 0 && caller[ci] < 0) {
+				caller[ci] = queue[q];
+				queue.push_back(ci);
+			}
+		}
+	}
+}
+
+String
+CycleProfiler::read_handler(Element *e, void *thunk)
+{
+	CycleProfiler *cp = static_cast<CycleProfiler *>(e);
+	Vector<Sample> samples;
+	StringAccum sa;
+	uint64_t total = 0;
+
+	cp->collect(samples);
+
+	if (thunk) {
+		Vector<int> caller;
+		Vector<String> chain;
+
+		cp->call_chains(caller);
+		for (int i = 0; i < samples.size(); ++i) {
+			if (!samples[i].cycles)
+				continue;
+			chain.clear();
+			for (int j = i; ; j = caller[j]) {
+				chain.push_back(samples[j].e->name());
+				if (caller[j] < 0 || caller[j] == j)
+					break;
+			}
+			sa << "thread" << samples[i].thread;
+			for (int j = chain.size() - 1; j >= 0; --j)
+				sa << ';' << chain[j];
+			sa << ' ' << samples[i].cycles << '\n';
+		}
+		return sa.take_string();
+	}
+
+	for (int i = 0; i < samples.size(); ++i)
+		total += samples[i].cycles;
+	click_qsort(samples.begin(), samples.size(), sizeof(Sample),
+		    sample_compar, 0);
+
+	sa.snprintf(128, "%-6s %-24s %-20s %12s %12s %16s %10s %6s\n",
+		    "thread", "element", "class", "calls", "packets",
+		    "cycles", "cyc/call", "%");
+	for (int i = 0; i < samples.size() && samples[i].cycles; ++i) {
+		const Sample &s = samples[i];
+		unsigned permille = s.cycles * 1000 / total;
+
+		sa.snprintf(160, "%-6d %-24s %-20s %12llu %12llu %16llu %10llu %4u.%u\n",
+			    s.thread, s.e->name().c_str(), s.e->class_name(),
+			    (unsigned long long) s.calls,
+			    (unsigned long long) s.packets,
+			    (unsigned long long) s.cycles,
+			    (unsigned long long) (s.calls ? s.cycles / s.calls : 0),
+			    permille / 10, permille % 10);
+	}
+	return sa.take_string();
+}
+
+int
+CycleProfiler::write_handler(const String &, Element *e, void *,
+			     ErrorHandler *errh)
+{
+	Router *r = e->router();
+
+	for (int i = 0; i < r->nelements(); ++i) {
+		Element *x = r->element(i);
+		const Handler *h = Router::handler(x, "cycles");
+		if (h && h->writable())
+			h->call_write(String(), x, errh);
+	}
+	return 0;
+}
+
+void
+CycleProfiler::add_handlers()
+{
+	add_read_handler("table", read_handler, 0);
+	add_read_handler("collapsed", read_handler, 1);
+	add_write_handler("reset", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(CycleProfiler)
@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_CYCLEPROFILER_HH
+#define CLICK_CYCLEPROFILER_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/*
+=c
+
+CycleProfiler()
+
+=s information
+
+reports where the router spends its cycles
+
+=d
+
+Collects the cycle counters Click keeps for every element when built with
+LIBCLICK_STATS set to 2, and presents them as one table. Click reads the
+time stamp counter around every task run, timer, push and pull, and charges
+each element only for the cycles not spent in the elements it called, so
+the counts are exclusive.
+
+The counters are per element. Elements are listed under the thread their
+tasks are scheduled on; an element without tasks of its own runs on the
+thread of whoever calls it.
+
+With statistics compiled out the element refuses to configure, and the
+router pays nothing for it.
+
+=h table read-only
+
+Returns one line per element that used any cycles, busiest first: thread,
+name, class, calls, packets, cycles, cycles per call and share of all
+cycles.
+
+=h collapsed read-only
+
+Returns the counters in the collapsed stack format read by flamegraph.pl:
+one line per element holding the call chain from the element running the
+task or timer down to it, separated by semicolons, and its cycles.
+
+=h reset write-only
+
+Clears the counters of all elements.
+
+=a
+click-flatten(1)
+*/
+
+class CycleProfiler : public Element { public:
+
+    CycleProfiler();
+
+    const char *class_name() const	{ return "CycleProfiler"; }
+    const char *port_count() const	{ return PORTS_0_0; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    void add_handlers();
+
+    /* Calls and exclusive cycles of e, with or without push/pull */
+    static void read_cycles(Element *e, bool xfer, uint64_t &calls, uint64_t &cycles);
+    /* Packets through the ports of e ("icounts" or "ocounts") */
+    static uint64_t read_counts(Element *e, const char *name);
+
+  private:
+
+    struct Sample {
+	uint64_t cycles;	// first: sort key
+	uint64_t calls;
+	uint64_t packets;
+	Element *e;
+	int thread;
+    };
+
+    void collect(Vector<Sample> &);
+    void call_chains(Vector<int> &);
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,517 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "devicegenerator.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/router.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include <click_alloc.h>
+#include <click_cksum.h>
+
+#include <string.h>
+
+#include <uk/alloc.h>
+#include <uk/essentials.h>
+#include <uk/netbuf.h>
+#include <uk/netdev.h>
+
+CLICK_DECLS
+
+#define NSEC_PER_SEC	1000000000ULL
+
+enum {
+	H_COUNT, H_BYTES, H_RATE, H_BIT_RATE, H_TX_FULL, H_TX_ERRORS, H_ACTIVE,
+	H_RESET
+};
+
+/* Pacing and rates go by the monotonic clock */
+static inline uint64_t
+now_ns()
+{
+	return Timestamp::now_steady().nsecval();
+}
+
+/* Stamps go by the wall clock, which a receiver elsewhere can share */
+static inline uint64_t
+stamp_ns()
+{
+	return Timestamp::now().nsecval();
+}
+
+DeviceGenerator::DeviceGenerator()
+	: _task(this), _attached(false), _nheld(0), _pool(0), _nd(0)
+{
+}
+
+DeviceGenerator::~DeviceGenerator()
+{
+}
+
+int
+DeviceGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	IPAddress src_ip(htonl(0x0a000001)), dst_ip(htonl(0x0a000002));
+	bool have_src_eth = false;
+
+	_devid = 0;
+	_queue = -1;
+	_length = 64;
+	_burst = 32;
+	_npool = 4096;
+	_rate = 0;
+	_limit = 0;
+	_stamp = true;
+	_stop = false;
+	_active = true;
+	_dst_eth = EtherAddress::make_broadcast();
+	_sport = 1234;
+	_dport = 5678;
+	_src_count = _dst_count = _sport_count = _dport_count = 1;
+
+	if (Args(conf, this, errh)
+			.read_p("DEVID", IntArg(), _devid)
+			.read("DSTETH", _dst_eth)
+			.read("SRCETH", _src_eth).read_status(have_src_eth)
+			.read("SRCIP", src_ip)
+			.read("DSTIP", dst_ip)
+			.read("SRCIP_COUNT", _src_count)
+			.read("DSTIP_COUNT", _dst_count)
+			.read("SPORT", _sport)
+			.read("DPORT", _dport)
+			.read("SPORT_COUNT", _sport_count)
+			.read("DPORT_COUNT", _dport_count)
+			.read("LENGTH", _length)
+			.read("STAMP", _stamp)
+			.read("RATE", _rate)
+			.read("LIMIT", _limit)
+			.read("STOP", _stop)
+			.read("BURST", _burst)
+			.read("POOL", _npool)
+			.read("QUEUE", _queue)
+			.read("ACTIVE", _active)
+			.complete() < 0)
+		return -1;
+
+	if (_length < (_stamp ? CLICK_GEN_STAMP_OFFSET + sizeof(click_gen_stamp)
+		       : CLICK_GEN_STAMP_OFFSET) || _length > 65535)
+		return errh->error("LENGTH must be between %d and 65535",
+				   _stamp ? 62 : 42);
+	if (!_src_count || !_dst_count || !_sport_count || !_dport_count)
+		return errh->error("_COUNT arguments must be > 0");
+	if (_sport + _sport_count > 65536 || _dport + _dport_count > 65536)
+		return errh->error("port ranges must end below 65536");
+	if (_rate > NSEC_PER_SEC)
+		return errh->error("RATE must be at most 10^9");
+	if (_burst < 1 || _burst > GEN_BURST_MAX)
+		return errh->error("BURST must be between 1 and %d", GEN_BURST_MAX);
+	if (_npool <= _burst || _npool > (1U << 20))
+		return errh->error("POOL must be larger than BURST and at most 2^20");
+	_src_ip = ntohl(src_ip.addr());
+	_dst_ip = ntohl(dst_ip.addr());
+
+	if (!(_nd = NetDev::get(_devid, errh)))
+		return -1;
+	_dev = _nd->dev;
+	_dev_info = _nd->info;
+	if (_dev_info.max_mtu && _length > _dev_info.max_mtu + sizeof(click_ether))
+		return errh->error("LENGTH %u exceeds the MTU of device %d (%u)",
+				   _length, _devid, _dev_info.max_mtu);
+	if (!have_src_eth)
+		_src_eth = EtherAddress(uk_netdev_hwaddr_get(_dev)->addr_bytes);
+	return 0;
+}
+
+/* Sets a buffer up around mem, which starts out or comes back from the
+ * device with the packet of its last use.
+ */
+struct uk_netbuf *
+DeviceGenerator::prepare(TxPool *pool, void *mem)
+{
+	struct uk_netbuf *nb;
+	TxSlot *slot;
+
+	nb = uk_netbuf_prepare_buf(mem, pool->bufsize, pool->headroom,
+				   sizeof(TxSlot), tx_done);
+	if (!nb)
+		return NULL;
+	slot = static_cast<TxSlot *>(nb->priv);
+	slot->pool = pool;
+	slot->mem = mem;
+	return nb;
+}
+
+void
+DeviceGenerator::pool_put(TxPool *pool)
+{
+	if (pool->refs.dec_and_test())
+		delete pool;
+}
+
+/* Destructor of a transmit buffer, run when the device frees it after
+ * sending. Buffers from uk_netbuf_prepare_buf() have no allocator, so the
+ * memory stays ours and goes back to the pool as it is.
+ */
+void
+DeviceGenerator::tx_done(struct uk_netbuf *nb)
+{
+	TxSlot slot = *static_cast<TxSlot *>(nb->priv);
+
+	if (!slot.pool->closed
+	    && slot.pool->ring.enqueue(prepare(slot.pool, slot.mem)))
+		return;
+	click_mem_add(CLICK_MEM_NETBUFS, -(long) slot.pool->bufsize);
+	uk_free(slot.pool->a, slot.mem);
+	pool_put(slot.pool);
+}
+
+void
+DeviceGenerator::build_template(unsigned char *d)
+{
+	click_ether *eth = reinterpret_cast<click_ether *>(d);
+	click_ip *ip = reinterpret_cast<click_ip *>(eth + 1);
+	click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+
+	memset(d, 0, _length);
+	memcpy(eth->ether_dhost, _dst_eth.data(), 6);
+	memcpy(eth->ether_shost, _src_eth.data(), 6);
+	eth->ether_type = htons(ETHERTYPE_IP);
+	ip->ip_v = 4;
+	ip->ip_hl = sizeof(click_ip) >> 2;
+	ip->ip_len = htons(_length - sizeof(click_ether));
+	ip->ip_ttl = 64;
+	ip->ip_p = IP_PROTO_UDP;
+	ip->ip_src.s_addr = htonl(_src_ip);
+	ip->ip_dst.s_addr = htonl(_dst_ip);
+	ip->ip_sum = click_in_cksum(reinterpret_cast<unsigned char *>(ip),
+				    sizeof(click_ip));
+	udp->uh_sport = htons(_sport);
+	udp->uh_dport = htons(_dport);
+	udp->uh_ulen = htons(_length - sizeof(click_ether) - sizeof(click_ip));
+	if (_stamp)
+		reinterpret_cast<click_gen_stamp *>(d + CLICK_GEN_STAMP_OFFSET)->magic
+			= CLICK_GEN_STAMP_MAGIC;
+}
+
+int
+DeviceGenerator::initialize(ErrorHandler *errh)
+{
+	unsigned char *tmpl;
+	size_t align;
+	uint16_t ntxq;
+	int home;
+
+	if (_nd->start(errh) < 0)
+		return -1;
+	ScheduleInfo::initialize_task(this, &_task, _active, errh);
+	ntxq = _nd->ntxq;
+	home = _task.home_thread_id();
+	if (_queue >= ntxq)
+		return errh->error("QUEUE must be a TX queue of device %d (0 to %u)",
+				   _devid, ntxq - 1);
+	if (_queue < 0) {
+		/* the thread's queue, else one no other thread sends on */
+		for (uint16_t i = 0; i < ntxq && _queue < 0; ++i)
+			if (_nd->attach_tx((home + i) % ntxq, home,
+					   ErrorHandler::silent_handler()) == 0)
+				_queue = (home + i) % ntxq;
+		if (_queue < 0)
+			return errh->error("all TX queues of device %d are used by other threads",
+					   _devid);
+	} else if (_nd->attach_tx(_queue, home, errh) < 0)
+		return -1;
+	_attached = true;
+
+	_pool = new TxPool;
+	if (!_pool || _pool->ring.initialize(_npool) < 0)
+		return errh->error("out of memory");
+	_pool->a = uk_alloc_get_default();
+	_pool->headroom = _dev_info.nb_encap_tx;
+	_pool->bufsize = _pool->headroom + _length + sizeof(struct uk_netbuf)
+		+ sizeof(TxSlot) + 2 * sizeof(void *);
+	align = _dev_info.ioalign > sizeof(void *) ? _dev_info.ioalign : sizeof(void *);
+
+	tmpl = new unsigned char[_length];
+	if (!tmpl)
+		return errh->error("out of memory");
+	build_template(tmpl);
+	for (uint32_t i = 0; i < _npool; ++i) {
+		void *mem = uk_memalign(_pool->a, align, _pool->bufsize);
+		struct uk_netbuf *nb;
+
+		if (!mem || !(nb = prepare(_pool, mem))) {
+			uk_free(_pool->a, mem);
+			delete[] tmpl;
+			return errh->error("out of memory for %u transmit buffers", _npool);
+		}
+		memcpy(nb->data, tmpl, _length);
+		click_mem_add(CLICK_MEM_NETBUFS, _pool->bufsize);
+		_pool->refs++;
+		_pool->ring.enqueue(nb);
+	}
+	delete[] tmpl;
+
+	_seq = 0;
+	_count = _bytes = _tx_full = _tx_errors = 0;
+	_src_i = _dst_i = _sport_i = _dport_i = 0;
+	restart();
+	return 0;
+}
+
+void
+DeviceGenerator::cleanup(CleanupStage)
+{
+	struct uk_netbuf *buf;
+
+	if (_attached) {
+		_nd->detach_tx(_queue);
+		_attached = false;
+	}
+	if (!_pool)
+		return;
+	/* freeing runs tx_done(), which lets go of closed pools' memory */
+	_pool->closed = true;
+	click_fence();
+	for (uint32_t i = 0; i < _nheld; ++i)
+		uk_netbuf_free(_held[i]);
+	_nheld = 0;
+	while (_pool->ring.dequeue(buf))
+		uk_netbuf_free(buf);
+	pool_put(_pool);
+	_pool = 0;
+}
+
+void
+DeviceGenerator::restart()
+{
+	_epoch_ns = _rate_ns = now_ns();
+	_epoch_count = _rate_count = _count;
+	_rate_bytes = _bytes;
+}
+
+/* Rewrites the fields that differ between packets, in a buffer that still
+ * holds the packet of its previous use.
+ */
+inline void
+DeviceGenerator::vary(unsigned char *d, uint64_t stamp)
+{
+	click_ip *ip = reinterpret_cast<click_ip *>(d + sizeof(click_ether));
+	click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+	uint32_t a;
+
+	if (_src_count > 1) {
+		a = htonl(_src_ip + _src_i);
+		ip->ip_sum = click_cksum_adjust32(ip->ip_sum, ip->ip_src.s_addr, a);
+		ip->ip_src.s_addr = a;
+		if (++_src_i == _src_count)
+			_src_i = 0;
+	}
+	if (_dst_count > 1) {
+		a = htonl(_dst_ip + _dst_i);
+		ip->ip_sum = click_cksum_adjust32(ip->ip_sum, ip->ip_dst.s_addr, a);
+		ip->ip_dst.s_addr = a;
+		if (++_dst_i == _dst_count)
+			_dst_i = 0;
+	}
+	if (_sport_count > 1) {
+		udp->uh_sport = htons(_sport + _sport_i);
+		if (++_sport_i == _sport_count)
+			_sport_i = 0;
+	}
+	if (_dport_count > 1) {
+		udp->uh_dport = htons(_dport + _dport_i);
+		if (++_dport_i == _dport_count)
+			_dport_i = 0;
+	}
+	if (_stamp) {
+		click_gen_stamp *st = reinterpret_cast<click_gen_stamp *>(d + CLICK_GEN_STAMP_OFFSET);
+
+		st->seq = _seq++;
+		st->ns = stamp;
+	}
+}
+
+bool
+DeviceGenerator::run_task(Task *)
+{
+	struct uk_netbuf *bufs[GEN_BURST_MAX];
+	uint64_t now, stamp = 0, el, due, sent;
+	uint32_t n = _burst, got, fresh;
+	uint16_t cnt;
+	int ret;
+
+	if (!_active)
+		return false;
+	if (_limit) {
+		if (_count >= _limit) {
+			if (_stop)
+				router()->please_stop_driver();
+			return false;
+		}
+		if (_limit - _count < n)
+			n = _limit - _count;
+	}
+	if (_rate) {
+		/* packets due since the epoch, without overflowing */
+		now = now_ns();
+		el = now - _epoch_ns;
+		due = el / NSEC_PER_SEC * _rate + el % NSEC_PER_SEC * _rate / NSEC_PER_SEC;
+		sent = _count - _epoch_count;
+		if (due <= sent) {
+			_task.fast_reschedule();
+			return false;
+		}
+		if (due - sent < n)
+			n = due - sent;
+	}
+
+	/* the device refused these last time; they keep their sequence numbers */
+	got = _nheld < n ? _nheld : n;
+	memcpy(bufs, _held, got * sizeof(bufs[0]));
+	memmove(_held, _held + got, (_nheld - got) * sizeof(_held[0]));
+	_nheld -= got;
+	fresh = _pool->ring.dequeue_burst(bufs + got, n - got);
+	if (_stamp && fresh)
+		stamp = stamp_ns();
+	for (uint32_t i = got; i < got + fresh; ++i) {
+		bufs[i]->len = _length;
+		vary(static_cast<unsigned char *>(bufs[i]->data), stamp);
+	}
+	got += fresh;
+	if (!got) {
+		_task.fast_reschedule();
+		return false;
+	}
+
+	cnt = got;
+	ret = uk_netdev_tx_burst(_dev, _queue, bufs, &cnt);
+	if (unlikely(ret < 0)) {
+		/* Lost with their sequence numbers; freeing puts them back
+		 * into the pool, see tx_done()
+		 */
+		_tx_errors += got - cnt;
+		for (uint32_t i = cnt; i < got; ++i)
+			uk_netbuf_free(bufs[i]);
+	} else if (cnt < got) {
+		_tx_full++;
+		memmove(_held + (got - cnt), _held, _nheld * sizeof(_held[0]));
+		memcpy(_held, bufs + cnt, (got - cnt) * sizeof(_held[0]));
+		_nheld += got - cnt;
+	}
+	_count += cnt;
+	_bytes += (uint64_t) cnt * _length;
+	_task.fast_reschedule();
+	return cnt > 0;
+}
+
+String
+DeviceGenerator::read_handler(Element *e, void *thunk)
+{
+	DeviceGenerator *g = static_cast<DeviceGenerator *>(e);
+	uint64_t now, dt;
+	double r;
+
+	switch ((intptr_t) thunk) {
+	case H_COUNT:
+		return String(g->_count);
+	case H_BYTES:
+		return String(g->_bytes);
+	case H_TX_FULL:
+		return String(g->_tx_full);
+	case H_TX_ERRORS:
+		return String(g->_tx_errors);
+	case H_ACTIVE:
+		return String(g->_active);
+	case H_RATE:
+	case H_BIT_RATE:
+		now = now_ns();
+		dt = now - g->_rate_ns;
+		if ((intptr_t) thunk == H_RATE)
+			r = (double) (g->_count - g->_rate_count);
+		else
+			r = (double) (g->_bytes - g->_rate_bytes) * 8;
+		g->_rate_ns = now;
+		g->_rate_count = g->_count;
+		g->_rate_bytes = g->_bytes;
+		return String(dt ? (uint64_t) (r * NSEC_PER_SEC / dt) : 0);
+	}
+	return String();
+}
+
+int
+DeviceGenerator::write_handler(const String &s, Element *e, void *thunk,
+			       ErrorHandler *errh)
+{
+	DeviceGenerator *g = static_cast<DeviceGenerator *>(e);
+	bool active;
+
+	if ((intptr_t) thunk == H_RESET) {
+		g->_count = g->_bytes = g->_tx_full = g->_tx_errors = 0;
+		g->restart();
+		if (g->_active)
+			g->_task.reschedule();
+		return 0;
+	}
+	if (!BoolArg().parse(s, active))
+		return errh->error("syntax error");
+	if (active && !g->_active) {
+		g->restart();
+		g->_active = true;
+		g->_task.reschedule();
+	} else
+		g->_active = active;
+	return 0;
+}
+
+void
+DeviceGenerator::add_handlers()
+{
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("bytes", read_handler, H_BYTES);
+	add_read_handler("rate", read_handler, H_RATE);
+	add_read_handler("bit_rate", read_handler, H_BIT_RATE);
+	add_read_handler("tx_full", read_handler, H_TX_FULL);
+	add_read_handler("tx_errors", read_handler, H_TX_ERRORS);
+	add_read_handler("active", read_handler, H_ACTIVE);
+	add_write_handler("active", write_handler, H_ACTIVE, Handler::CHECKBOX);
+	add_write_handler("reset", write_handler, H_RESET, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(NetDevice)
+EXPORT_ELEMENT(DeviceGenerator)
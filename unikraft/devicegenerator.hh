@@ -0,0 +1,306 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_DEVICEGENERATOR_HH
+#define CLICK_DEVICEGENERATOR_HH
+
+#include <click/config.h>
+#include <click/atomic.hh>
+#include <click/element.hh>
+#include <click/etheraddress.hh>
+#include <click/ipaddress.hh>
+#include <click/task.hh>
+#include "lfring.hh"
+#include "netdevice.hh"
+
+#include <uk/netdev.h>
+
+CLICK_DECLS
+
+extern "C" {
+    struct uk_netdev;
+}
+
+/* Written by DeviceGenerator right after the UDP header, in host byte
+ * order, and read back by GeneratorCheck.
+ */
+struct click_gen_stamp {
+    uint32_t magic;
+    uint64_t seq;
+    uint64_t ns;
+} __attribute__((packed));
+
+#define CLICK_GEN_STAMP_MAGIC	0x4e47434bU	/* "CKGN" */
+#define CLICK_GEN_STAMP_OFFSET	42		/* Ethernet + IPv4 + UDP */
+
+#define GEN_BURST_MAX		256
+
+/*
+=c
+
+DeviceGenerator(DEVID [, I<keywords> DSTETH, SRCETH, SRCIP, DSTIP, SPORT, DPORT, LENGTH, RATE, LIMIT, ...])
+
+=s netdevices
+
+sends generated UDP packets on a Unikraft network device
+
+=d
+
+Transmits UDP over IPv4 packets of LENGTH bytes on network device DEVID,
+as fast as the device takes them or at RATE packets per second. The device
+is set up by a NetDevice element, or with its defaults if there is none,
+so the generator needs no FromDevice.
+
+Packets are built once, into a pool of POOL transmit buffers allocated at
+initialization. The device frees a buffer after sending it, which hands it
+back to the pool with its contents intact, so sending costs neither an
+allocation nor a copy: only the fields that vary from packet to packet are
+rewritten in place. These are the source and destination addresses and
+ports, which walk through the ranges given by the _COUNT keywords, and a
+stamp after the UDP header with a sequence number and the time of
+sending, which GeneratorCheck evaluates at the receiver. The IP checksum is
+updated incrementally; the UDP checksum is 0.
+
+Keyword arguments are:
+
+=over 8
+
+=item DSTETH, SRCETH
+
+Ethernet addresses. Default destination is the broadcast address, default
+source the device's own address.
+
+=item SRCIP, DSTIP
+
+IP addresses of the first packet. Defaults are 10.0.0.1 and 10.0.0.2.
+
+=item SRCIP_COUNT, DSTIP_COUNT
+
+Integers. Number of consecutive addresses the packets cycle through,
+starting from SRCIP and DSTIP. Default is 1.
+
+=item SPORT, DPORT
+
+UDP ports of the first packet. Defaults are 1234 and 5678.
+
+=item SPORT_COUNT, DPORT_COUNT
+
+Integers. Number of consecutive ports the packets cycle through. Default
+is 1.
+
+=item LENGTH
+
+Integer. Frame length in bytes, without the Ethernet FCS. At least 62 with
+STAMP, 42 without. Default is 64.
+
+=item STAMP
+
+Boolean. Write a sequence number and time stamp into every packet. The
+time stamp is wall-clock time (Timestamp::now()). Default is true.
+
+=item RATE
+
+Integer. Packets per second. Default is 0, as fast as possible.
+
+=item LIMIT
+
+Integer. Stop after this many packets. Default is 0, no limit.
+
+=item STOP
+
+Boolean. Stop the router once LIMIT packets are sent. Default is false.
+
+=item BURST
+
+Integer. Packets handed to the device per call, at most 256. Default is
+32.
+
+=item POOL
+
+Integer. Number of transmit buffers. Must exceed the TX ring of the
+device (NetDevice's TX_RING), since the device only frees sent buffers
+when it is given new ones. Default is 4096.
+
+=item QUEUE
+
+Integer. TX queue to send on. Default is the queue of the thread running
+the generator, as with ToDevice, or if another thread sends on that one,
+the next queue no other thread sends on. A queue that a ToDevice or
+generator on another thread sends on is refused.
+
+=item ACTIVE
+
+Boolean. Whether to send. Default is true.
+
+=back
+
+=h count read-only
+
+Returns the number of packets sent.
+
+=h bytes read-only
+
+Returns the number of bytes sent.
+
+=h rate read-only
+
+Returns the achieved rate in packets per second since the previous read
+of "rate" or "bit_rate", or since sending started.
+
+=h bit_rate read-only
+
+Same in bits per second, counting frames without FCS.
+
+=h tx_full read-only
+
+Returns how often the device took fewer packets than it was given.
+
+=h tx_errors read-only
+
+Returns the number of packets lost because the device failed to send them.
+Their sequence numbers count as lost in GeneratorCheck.
+
+=h active read/write
+
+Whether to send. Turning the generator on restarts the rate measurement
+and the pacing of RATE.
+
+=h reset write-only
+
+Clears the counters, so that LIMIT starts over. Sequence numbers continue.
+
+=e
+
+  NetDevice(0, TX_RING 1024);
+  DeviceGenerator(0, DSTETH $MAC1, SRCIP_COUNT 256, RATE 1000000);
+
+=a GeneratorCheck, NetDevice, ToDevice
+*/
+
+class DeviceGenerator : public Element {
+public:
+    DeviceGenerator();
+    ~DeviceGenerator();
+
+    const char *class_name() const { return "DeviceGenerator"; }
+    const char *port_count() const { return PORTS_0_0; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    bool run_task(Task *);
+
+private:
+    /* Transmit buffers not in the device. Every buffer holds a reference
+     * to the pool and the generator one more, so whoever lets go last
+     * frees it.
+     */
+    struct TxPool {
+	MPSCRing<struct uk_netbuf *> ring;
+	atomic_uint32_t refs;
+	volatile bool closed;
+	struct uk_alloc *a;
+	size_t bufsize;
+	uint16_t headroom;
+
+	TxPool() : closed(false) { refs = 1; }
+    };
+
+    /* Private area of each buffer */
+    struct TxSlot {
+	TxPool *pool;
+	void *mem;
+    };
+
+    static void tx_done(struct uk_netbuf *);
+    static void pool_put(TxPool *);
+    static struct uk_netbuf *prepare(TxPool *, void *mem);
+    void build_template(unsigned char *);
+    inline void vary(unsigned char *, uint64_t stamp);
+    void restart();
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+    Task _task;
+
+    int _devid;
+    int _queue;
+    bool _attached;		/* to _queue, see NetDev::attach_tx() */
+    uint32_t _length;
+    uint32_t _burst;
+    uint32_t _npool;
+    uint64_t _rate;
+    uint64_t _limit;
+    bool _stamp;
+    bool _stop;
+    bool _active;
+
+    EtherAddress _dst_eth;
+    EtherAddress _src_eth;
+    uint32_t _src_ip;		/* host byte order */
+    uint32_t _dst_ip;
+    uint16_t _sport;
+    uint16_t _dport;
+    uint32_t _src_count;
+    uint32_t _dst_count;
+    uint32_t _sport_count;
+    uint32_t _dport_count;
+    uint32_t _src_i;
+    uint32_t _dst_i;
+    uint32_t _sport_i;
+    uint32_t _dport_i;
+
+    uint64_t _seq;
+    uint64_t _count;
+    uint64_t _bytes;
+    uint64_t _tx_full;
+    uint64_t _tx_errors;
+    uint64_t _epoch_ns;		/* pacing of RATE counts from here */
+    uint64_t _epoch_count;
+    uint64_t _rate_ns;		/* rate handler measures from here */
+    uint64_t _rate_count;
+    uint64_t _rate_bytes;
+
+    /* Buffers the device did not take, sent first next time */
+    struct uk_netbuf *_held[GEN_BURST_MAX];
+    uint32_t _nheld;
+
+    TxPool *_pool;
+    NetDev *_nd;
+    struct uk_netdev *_dev;
+    struct uk_netdev_info _dev_info;
+};
+
+CLICK_ENDDECLS
+#endif
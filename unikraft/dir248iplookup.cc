@@ -0,0 +1,686 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dir248iplookup.hh"
+
+#include <click/args.hh>
+#include <click/atomic.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+
+#include <click_alloc.h>
+#include <click_tables.h>
+
+CLICK_DECLS
+
+static inline uint32_t
+prefix_mask(int depth)
+{
+	return depth ? 0xFFFFFFFFU << (32 - depth) : 0;
+}
+
+Dir248IPLookup::Dir248IPLookup()
+	: _t(0), _old_t(0), _ngroups(4096), _retire_timer(this), _vfree(-1)
+{
+}
+
+Dir248IPLookup::~Dir248IPLookup()
+{
+}
+
+int
+Dir248IPLookup::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	String table, data;
+
+	if (Args(conf, this, errh)
+			.read("TBL8_GROUPS", _ngroups)
+			.read("TABLE", AnyArg(), table)
+			.consume() < 0)
+		return -1;
+
+	if (!_ngroups || _ngroups > (uint32_t) TBL8_MAX_GROUPS)
+		return errh->error("TBL8_GROUPS out of range");
+	if (!(_t = alloc_table(_ngroups, errh)))
+		return -1;
+	if (!_v.reserve(ROUTES_MIN))
+		return errh->error("out of memory");
+	_t->routes = _v.begin();
+	if (table) {
+		if (!click_initrd_member(table, data))
+			return errh->error("no table %<%s%> in the initrd",
+					   table.c_str());
+		if (load_table(data, errh) < 0)
+			return -1;
+	}
+
+	return IPRouteTable::configure(conf, errh);
+}
+
+int
+Dir248IPLookup::initialize(ErrorHandler *errh)
+{
+	if (BatchElementBase<IPRouteTable>::initialize(errh) < 0)
+		return -1;
+	_retire_timer.initialize(this);
+	/* nothing looked up before, see retire() */
+	run_timer(&_retire_timer);
+	return 0;
+}
+
+void
+Dir248IPLookup::cleanup(CleanupStage)
+{
+	free_table(_t);
+	free_table(_old_t);
+	_t = _old_t = 0;
+}
+
+Dir248IPLookup::Table *
+Dir248IPLookup::alloc_table(uint32_t ngroups, ErrorHandler *errh)
+{
+	ClickMemScope mem(CLICK_MEM_TABLES);
+	Table *t = new Table;
+
+	if (!t) {
+		errh->error("out of memory");
+		return 0;
+	}
+	t->tbl24 = new uint32_t[TBL24_SIZE];
+	t->tbl8 = new uint32_t[(size_t) ngroups * TBL8_SIZE];
+	if (!t->tbl24 || !t->tbl8) {
+		free_table(t);
+		errh->error("out of memory allocating %u tbl8 groups", ngroups);
+		return 0;
+	}
+	memset(t->tbl24, 0, sizeof(uint32_t) * TBL24_SIZE);
+	t->routes = 0;
+	t->ngroups = ngroups;
+	t->nused = 0;
+	for (uint32_t g = 0; g < ngroups; ++g)
+		t->free_groups.push_back(g);
+	return t;
+}
+
+void
+Dir248IPLookup::free_table(Table *t)
+{
+	if (!t)
+		return;
+	delete[] t->tbl24;
+	delete[] t->tbl8;
+	delete t;
+}
+
+/* Lookups take well below a millisecond, so whatever was retired before
+ * the timer went off is no longer in use.
+ */
+void
+Dir248IPLookup::run_timer(Timer *)
+{
+	free_table(_old_t);
+	_old_t = 0;
+	Vector<IPRoute>().swap(_old_v);
+}
+
+/* Keeps the storage of v for lookups that may still index it and frees it
+ * RETIRE_MS later. Something retired before and not yet freed has been out
+ * of use at least since then and goes right away.
+ */
+void
+Dir248IPLookup::retire(Vector<IPRoute> &v)
+{
+	_old_v.swap(v);
+	if (_retire_timer.initialized())
+		_retire_timer.schedule_after_msec(RETIRE_MS);
+}
+
+/* Lookups that started on _t may still be running, so it is retired like
+ * route storage
+ */
+void
+Dir248IPLookup::swap_table(Table *t)
+{
+	click_fence();
+	free_table(_old_t);
+	_old_t = _t;
+	_t = t;
+	if (_retire_timer.initialized())
+		_retire_timer.schedule_after_msec(RETIRE_MS);
+}
+
+int
+Dir248IPLookup::alloc_group(Table *t, uint32_t fill)
+{
+	uint32_t g, *grp;
+
+	if (t->free_groups.empty())
+		return -1;
+	g = t->free_groups.front();
+	t->free_groups.pop_front();
+	grp = t->tbl8 + g * TBL8_SIZE;
+	for (int j = 0; j < TBL8_SIZE; ++j)
+		grp[j] = fill;
+	++t->nused;
+	return g;
+}
+
+void
+Dir248IPLookup::free_group(Table *t, uint32_t g)
+{
+	/* Freed groups go to the back of the queue, so a lookup that read the
+	 * old first-level entry just before it was replaced still finds the
+	 * group's old contents.
+	 */
+	t->free_groups.push_back(g);
+	--t->nused;
+}
+
+void
+Dir248IPLookup::maybe_collapse(Table *t, uint32_t i24)
+{
+	uint32_t e = t->tbl24[i24];
+	uint32_t *grp;
+
+	if (!(e & E_EXT))
+		return;
+	grp = t->tbl8 + (e & E_VALUE_MASK) * TBL8_SIZE;
+	for (int j = 1; j < TBL8_SIZE; ++j)
+		if (grp[j] != grp[0])
+			return;
+	if ((grp[0] & E_VALID) && entry_depth(grp[0]) > 24)
+		return;
+	t->tbl24[i24] = grp[0];
+	free_group(t, e & E_VALUE_MASK);
+}
+
+int
+Dir248IPLookup::insert(Table *t, uint32_t addr, int depth, uint32_t idx)
+{
+	uint32_t e = make_entry(idx, depth);
+	uint32_t cur, *grp;
+	uint32_t start, end;
+	int g;
+
+	if (depth <= 24) {
+		start = addr >> 8;
+		end = start + (1U << (24 - depth));
+		for (uint32_t i = start; i < end; ++i) {
+			cur = t->tbl24[i];
+			if (!(cur & E_EXT)) {
+				if (!(cur & E_VALID) || entry_depth(cur) <= depth)
+					t->tbl24[i] = e;
+				continue;
+			}
+			grp = t->tbl8 + (cur & E_VALUE_MASK) * TBL8_SIZE;
+			for (int j = 0; j < TBL8_SIZE; ++j)
+				if (!(grp[j] & E_VALID)
+				    || entry_depth(grp[j]) <= depth)
+					grp[j] = e;
+		}
+		return 0;
+	}
+
+	start = addr & 0xFF;
+	end = start + (1U << (32 - depth));
+	cur = t->tbl24[addr >> 8];
+	if (cur & E_EXT) {
+		grp = t->tbl8 + (cur & E_VALUE_MASK) * TBL8_SIZE;
+		for (uint32_t j = start; j < end; ++j)
+			if (!(grp[j] & E_VALID) || entry_depth(grp[j]) <= depth)
+				grp[j] = e;
+		return 0;
+	}
+
+	/* Fill a new group completely before publishing it */
+	if ((g = alloc_group(t, cur)) < 0)
+		return -ENOMEM;
+	grp = t->tbl8 + g * TBL8_SIZE;
+	for (uint32_t j = start; j < end; ++j)
+		grp[j] = e;
+	click_fence();
+	t->tbl24[addr >> 8] = E_VALID | E_EXT | g;
+	return 0;
+}
+
+void
+Dir248IPLookup::erase(Table *t, uint32_t addr, int depth, uint32_t sub)
+{
+	uint32_t cur, *grp;
+	uint32_t start, end;
+
+	if (depth <= 24) {
+		start = addr >> 8;
+		end = start + (1U << (24 - depth));
+		for (uint32_t i = start; i < end; ++i) {
+			cur = t->tbl24[i];
+			if (!(cur & E_EXT)) {
+				if ((cur & E_VALID) && entry_depth(cur) == depth)
+					t->tbl24[i] = sub;
+				continue;
+			}
+			grp = t->tbl8 + (cur & E_VALUE_MASK) * TBL8_SIZE;
+			for (int j = 0; j < TBL8_SIZE; ++j)
+				if ((grp[j] & E_VALID)
+				    && entry_depth(grp[j]) == depth)
+					grp[j] = sub;
+			maybe_collapse(t, i);
+		}
+		return;
+	}
+
+	cur = t->tbl24[addr >> 8];
+	if (!(cur & E_EXT))
+		return;
+	start = addr & 0xFF;
+	end = start + (1U << (32 - depth));
+	grp = t->tbl8 + (cur & E_VALUE_MASK) * TBL8_SIZE;
+	for (uint32_t j = start; j < end; ++j)
+		if ((grp[j] & E_VALID) && entry_depth(grp[j]) == depth)
+			grp[j] = sub;
+	maybe_collapse(t, addr >> 8);
+}
+
+uint32_t
+Dir248IPLookup::covering_entry(uint32_t addr, int depth) const
+{
+	for (int d = depth - 1; d >= 0; --d) {
+		HashTable<uint64_t, int>::const_iterator it =
+			_prefixes.find(prefix_key(addr & prefix_mask(d), d));
+		if (it != _prefixes.end())
+			return make_entry(it.value(), d);
+	}
+	return 0;
+}
+
+int
+Dir248IPLookup::add_route(const IPRoute &route, bool allow_replace,
+		IPRoute *old_route, ErrorHandler *errh)
+{
+	int depth = route.prefix_len();
+	uint32_t addr;
+	uint64_t key;
+	int idx, old_idx = -1;
+
+	if (depth < 0)
+		return -EINVAL;
+	addr = ntohl(route.addr.addr()) & prefix_mask(depth);
+	key = prefix_key(addr, depth);
+
+	HashTable<uint64_t, int>::iterator it = _prefixes.find(key);
+	if (it != _prefixes.end()) {
+		if (!allow_replace)
+			return -EEXIST;
+		old_idx = it.value();
+		if (old_route)
+			*old_route = _v[old_idx];
+	}
+
+	if (_vfree >= 0) {
+		idx = _vfree;
+		_vfree = _v[idx].extra;
+	} else if (_v.size() <= (int) E_VALUE_MASK) {
+		if (_v.size() == _v.capacity() && grow_routes(errh) < 0)
+			return -ENOMEM;
+		idx = _v.size();
+		_v.push_back(IPRoute());
+	} else
+		return -ENOMEM;
+	_v[idx] = route;
+
+	/* An existing prefix is replaced by writing the new slot over it, so
+	 * lookups never see the prefix disappear.
+	 */
+	if (insert(_t, addr, depth, idx) < 0) {
+		_v[idx].extra = _vfree;
+		_vfree = idx;
+		if (errh)
+			errh->error("out of tbl8 groups");
+		return -ENOMEM;
+	}
+	_prefixes.set(key, idx);
+	if (old_idx >= 0) {
+		_v[old_idx].extra = _vfree;
+		_vfree = old_idx;
+	}
+	return 0;
+}
+
+int
+Dir248IPLookup::remove_route(const IPRoute &route, IPRoute *old_route,
+		ErrorHandler *)
+{
+	int depth = route.prefix_len();
+	uint32_t addr;
+	uint64_t key;
+	int idx;
+
+	if (depth < 0)
+		return -ENOENT;
+	addr = ntohl(route.addr.addr()) & prefix_mask(depth);
+	key = prefix_key(addr, depth);
+
+	HashTable<uint64_t, int>::iterator it = _prefixes.find(key);
+	if (it == _prefixes.end())
+		return -ENOENT;
+	idx = it.value();
+	if (route.port >= 0
+	    && (route.port != _v[idx].port || route.gw != _v[idx].gw))
+		return -ENOENT;
+	if (old_route)
+		*old_route = _v[idx];
+
+	_prefixes.erase(key);
+	erase(_t, addr, depth, covering_entry(addr, depth));
+	_v[idx].extra = _vfree;
+	_vfree = idx;
+	return 0;
+}
+
+int
+Dir248IPLookup::lookup_route(IPAddress addr, IPAddress &gw) const
+{
+	const Table *t = _t;
+	uint32_t a = ntohl(addr.addr());
+	uint32_t e = t->tbl24[a >> 8];
+
+	if (e & E_EXT)
+		e = t->tbl8[(e & E_VALUE_MASK) * TBL8_SIZE + (a & 0xFF)];
+	if (!(e & E_VALID))
+		return -1;
+	/* routes may have grown for e, see grow_routes() */
+	click_compiler_fence();
+	const IPRoute &r = t->routes[e & E_VALUE_MASK];
+	gw = r.gw;
+	return r.port;
+}
+
+void
+Dir248IPLookup::push_batch(int, PacketBatch &batch)
+{
+	Packet *ps[BATCH_MAX];
+	IPAddress addrs[BATCH_MAX], gws[BATCH_MAX];
+	int ports[BATCH_MAX];
+	PacketBatch run;
+	int n, port = -1;
+
+	while (!batch.empty()) {
+		for (n = 0; n < BATCH_MAX && (ps[n] = batch.pop_front()); ++n)
+			addrs[n] = ps[n]->dst_ip_anno();
+		lookup_batch(addrs, ports, gws, n);
+		for (int i = 0; i < n; ++i) {
+			if (ports[i] < 0) {
+				static int complained = 0;
+				if (++complained <= 5)
+					click_chatter("%s: no route for %s", declaration().c_str(),
+						      addrs[i].unparse().c_str());
+				ps[i]->kill();
+				continue;
+			}
+			if (gws[i])
+				ps[i]->set_dst_ip_anno(gws[i]);
+			if (ports[i] != port && !run.empty())
+				output_push_batch(port, run);
+			port = ports[i];
+			run.append(ps[i]);
+		}
+	}
+	if (!run.empty())
+		output_push_batch(port, run);
+}
+
+void
+Dir248IPLookup::lookup_batch(const IPAddress *addrs, int *ports,
+		IPAddress *gws, int n) const
+{
+	const Table *t = _t;
+	uint32_t a[BATCH_MAX], e[BATCH_MAX];
+	int i, off, m;
+
+	for (off = 0; off < n; off += m) {
+		m = n - off < BATCH_MAX ? n - off : BATCH_MAX;
+		for (i = 0; i < m; ++i) {
+			a[i] = ntohl(addrs[off + i].addr());
+			__builtin_prefetch(&t->tbl24[a[i] >> 8]);
+		}
+		for (i = 0; i < m; ++i) {
+			e[i] = t->tbl24[a[i] >> 8];
+			if (e[i] & E_EXT) {
+				e[i] = (e[i] & E_VALUE_MASK) * TBL8_SIZE
+					+ (a[i] & 0xFF);
+				__builtin_prefetch(&t->tbl8[e[i]]);
+				e[i] |= E_EXT;
+			}
+		}
+		for (i = 0; i < m; ++i)
+			if (e[i] & E_EXT)
+				e[i] = t->tbl8[e[i] & ~E_EXT];
+		click_compiler_fence();
+		for (i = 0; i < m; ++i) {
+			uint32_t x = e[i];
+
+			if (!(x & E_VALID)) {
+				ports[off + i] = -1;
+				continue;
+			}
+			const IPRoute &r = t->routes[x & E_VALUE_MASK];
+			gws[off + i] = r.gw;
+			ports[off + i] = r.port;
+		}
+	}
+}
+
+String
+Dir248IPLookup::dump_routes()
+{
+	StringAccum sa;
+
+	for (int j = _vfree; j >= 0; j = _v[j].extra)
+		_v[j].kill();
+	for (int i = 0; i < _v.size(); i++)
+		if (_v[i].real())
+			_v[i].unparse(sa, true) << '\n';
+	return sa.take_string();
+}
+
+/* Builds a table for the routes in v and swaps it in */
+int
+Dir248IPLookup::rebuild(const Vector<IPRoute> &v, ErrorHandler *errh)
+{
+	Table *t = alloc_table(_ngroups, errh);
+
+	if (!t)
+		return -1;
+	for (HashTable<uint64_t, int>::iterator it = _prefixes.begin();
+	     it.live(); ++it)
+		if (insert(t, it.key() >> 8, it.key() & 0xFF, it.value()) < 0) {
+			free_table(t);
+			return errh->error("out of tbl8 groups");
+		}
+	t->routes = v.begin();
+	swap_table(t);
+	return 0;
+}
+
+/* Lookups index the route array without a lock, so it never grows in
+ * place. This copies the routes into a larger array and points the live
+ * table at it; the entries stay as they are. Lookups read an entry before
+ * the array, so one that finds an index only the new array has also finds
+ * the new array. The old one is retired.
+ */
+int
+Dir248IPLookup::grow_routes(ErrorHandler *errh)
+{
+	Vector<IPRoute> v;
+	int cap = _v.size() * 2;
+
+	if (!errh)
+		errh = ErrorHandler::silent_handler();
+	if (cap > (int) E_VALUE_MASK + 1)
+		cap = E_VALUE_MASK + 1;
+	if (!v.reserve(cap))
+		return errh->error("out of memory");
+	for (int i = 0; i < _v.size(); ++i)
+		v.push_back(_v[i]);
+	click_fence();
+	_t->routes = v.begin();
+	click_fence();
+	_v.swap(v);
+	retire(v);
+	return 0;
+}
+
+/* Builds a table from a binary one (see click_tables.h) next to the live
+ * one and swaps it in together with its routes.
+ */
+int
+Dir248IPLookup::load_table(const String &data, ErrorHandler *errh)
+{
+	const struct click_route4 *r = (const struct click_route4 *)
+		(data.data() + sizeof(struct click_table_hdr));
+	long n = click_table_count(data.data(), data.length(),
+				   CLICK_TABLE_MAGIC_IP4, sizeof(*r));
+	HashTable<uint64_t, int> prefixes;
+	Vector<IPRoute> v;
+	uint32_t ngroups = _ngroups, nlong = 0;
+	long done = 0;
+	Table *t;
+
+	if (n < 0)
+		return errh->error("not a binary IPv4 route table");
+	if (n > (long) E_VALUE_MASK)
+		return errh->error("too many routes");
+	for (long i = 0; i < n; ++i)
+		if (r[i].prefix_len > 24)
+			++nlong;
+	if (nlong > ngroups)
+		ngroups = nlong < (uint32_t) TBL8_MAX_GROUPS ? nlong
+			: (uint32_t) TBL8_MAX_GROUPS;
+
+	/* Later entries replace earlier ones for the same prefix */
+	/* room to add routes before the array has to grow */
+	if (!v.reserve(n + n / 8 + ROUTES_MIN))
+		return errh->error("out of memory");
+	for (long i = 0; i < n; ++i) {
+		int depth = r[i].prefix_len;
+		int port = click_table_be16(r[i].port);
+		uint32_t addr = click_table_be32(r[i].addr);
+		uint64_t key;
+
+		if (depth > 32 || port >= noutputs())
+			return errh->error("bad route %ld: %s/%d port %d", i,
+					   IPAddress(htonl(addr)).unparse().c_str(),
+					   depth, port);
+		addr &= prefix_mask(depth);
+		key = prefix_key(addr, depth);
+		IPRoute route(IPAddress(htonl(addr)),
+			      IPAddress::make_prefix(depth),
+			      IPAddress(htonl(click_table_be32(r[i].gw))), port);
+		HashTable<uint64_t, int>::iterator it = prefixes.find(key);
+		if (it != prefixes.end())
+			v[it.value()] = route;
+		else {
+			prefixes.set(key, v.size());
+			v.push_back(route);
+		}
+		click_table_yield(i);
+	}
+
+	/* Lookups go on in the current table while this one is built */
+	if (!(t = alloc_table(ngroups, errh)))
+		return -1;
+	for (HashTable<uint64_t, int>::iterator it = prefixes.begin();
+	     it.live(); ++it, ++done) {
+		if (insert(t, it.key() >> 8, it.key() & 0xFF, it.value()) < 0) {
+			free_table(t);
+			return errh->error("out of tbl8 groups");
+		}
+		click_table_yield(done);
+	}
+	t->routes = v.begin();
+	swap_table(t);
+
+	/* The old routes are retired with the old table */
+	_v.swap(v);
+	retire(v);
+	_prefixes.swap(prefixes);
+	_vfree = -1;
+	_ngroups = ngroups;
+	return 0;
+}
+
+int
+Dir248IPLookup::load_handler(const String &data, Element *e, void *,
+		ErrorHandler *errh)
+{
+	return static_cast<Dir248IPLookup *>(e)->load_table(data, errh);
+}
+
+int
+Dir248IPLookup::flush_handler(const String &, Element *e, void *,
+		ErrorHandler *errh)
+{
+	Dir248IPLookup *l = static_cast<Dir248IPLookup *>(e);
+	HashTable<uint64_t, int> prefixes;
+
+	/* Swap in an empty table before dropping the routes it points to */
+	l->_prefixes.swap(prefixes);
+	if (l->rebuild(l->_v, errh) < 0) {
+		l->_prefixes.swap(prefixes);
+		return -1;
+	}
+	l->_v.clear();
+	l->_vfree = -1;
+	return 0;
+}
+
+String
+Dir248IPLookup::read_handler(Element *e, void *)
+{
+	Dir248IPLookup *l = static_cast<Dir248IPLookup *>(e);
+	StringAccum sa;
+
+	sa << l->_t->nused << '/' << l->_t->ngroups;
+	return sa.take_string();
+}
+
+void
+Dir248IPLookup::add_handlers()
+{
+	IPRouteTable::add_handlers();
+	add_write_handler("flush", flush_handler, 0);
+	add_write_handler("load", load_handler, 0);
+	add_read_handler("tbl8_groups", read_handler, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(IPRouteTable BatchElement)
+EXPORT_ELEMENT(Dir248IPLookup)
@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_DIR248IPLOOKUP_HH
+#define CLICK_DIR248IPLOOKUP_HH
+
+#include <click/config.h>
+#include <click/deque.hh>
+#include <click/hashtable.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include "elements/ip/iproutetable.hh"
+#include "batchelement.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+Dir248IPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ..., I<keywords> TBL8_GROUPS, TABLE)
+
+=s iproute
+
+IP routing lookup using DIR-24-8 tables
+
+=d
+
+Like the other IPRouteTable elements, Dir248IPLookup expects an IP packet
+with its destination address annotation set, looks up the longest matching
+route and emits the packet on the route's output port, setting the
+destination annotation to the route's gateway if it has one.
+
+Lookups take one memory access for prefixes up to /24 and two for longer
+ones: a 2^24 entry table is indexed by the upper 24 address bits, and
+longer prefixes are expanded into groups of 256 entries indexed by the last
+byte. The first table takes 64 MiB, each group 1 KiB.
+Batches from batch-capable elements are looked up 32 packets at a time,
+prefetching their first-level entries together.
+
+Single route updates are applied in place so that a concurrent lookup always
+sees either the old or the new next hop. Flushing the table or loading a
+binary one builds the new table off to the side and swaps it in; the old one
+is freed shortly after, once no lookup can still be using it. The route
+array grows without touching the table.
+
+Large tables load much faster in the binary format of click_tables.h,
+which click-mktable writes from the usual text routes.
+
+Keyword arguments are:
+
+=over 8
+
+=item TBL8_GROUPS
+
+Integer. Number of 256-entry groups available for prefixes longer than /24.
+Default is 4096. Binary tables get at least one group per such prefix.
+
+=item TABLE
+
+String. Name of a member of the initrd archive holding a binary table to
+start with. Routes given as arguments are added to it.
+
+=back
+
+=h add, set, remove, ctrl, table, lookup
+
+See IPRouteTable.
+
+=h flush write-only
+
+Removes all routes.
+
+=h load write-only
+
+Replaces all routes with the binary table written.
+
+=h tbl8_groups read-only
+
+Returns the number of used and available groups.
+
+=a IPRouteTable, DirectIPLookup, RadixIPLookup
+*/
+
+class Dir248IPLookup : public BatchElementBase<IPRouteTable> { public:
+
+    Dir248IPLookup();
+    ~Dir248IPLookup();
+
+    const char *class_name() const	{ return "Dir248IPLookup"; }
+    const char *port_count() const	{ return "1/-"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+    void run_timer(Timer *);
+
+    int add_route(const IPRoute &, bool, IPRoute *, ErrorHandler *);
+    int remove_route(const IPRoute &, IPRoute *, ErrorHandler *);
+    int lookup_route(IPAddress, IPAddress &) const;
+    String dump_routes();
+
+    void push_batch(int, PacketBatch &);
+
+    /* Looks up n addresses at once, prefetching all first-level entries
+     * before resolving any of them.
+     */
+    void lookup_batch(const IPAddress *addrs, int *ports, IPAddress *gws,
+		      int n) const;
+
+  private:
+
+    // Table entries: valid bit, group bit, prefix length, route index or
+    // group number
+    static const uint32_t E_VALID = 0x80000000U;
+    static const uint32_t E_EXT = 0x40000000U;
+    static const uint32_t E_DEPTH_MASK = 0x3F000000U;
+    static const uint32_t E_VALUE_MASK = 0x00FFFFFFU;
+    enum {
+	E_DEPTH_SHIFT = 24,
+	TBL24_SIZE = 1 << 24, TBL8_SIZE = 256, TBL8_MAX_GROUPS = 1 << 22,
+	BATCH_MAX = 32, ROUTES_MIN = 1024, RETIRE_MS = 100
+    };
+
+    struct Table {
+	const IPRoute *routes;	// what entries index, _v's storage
+	uint32_t *tbl24;
+	uint32_t *tbl8;
+	uint32_t ngroups;
+	uint32_t nused;
+	Deque<uint32_t> free_groups;	// FIFO, see free_group()
+    };
+
+    Table *_t;
+    Table *_old_t;		// retired, freed by run_timer()
+    uint32_t _ngroups;
+
+    Vector<IPRoute> _v;		// never reallocated in place, see grow_routes()
+    Vector<IPRoute> _old_v;	// retired route storage, freed by run_timer()
+    Timer _retire_timer;
+    int _vfree;
+    HashTable<uint64_t, int> _prefixes;
+
+    static inline uint32_t make_entry(uint32_t value, int depth) {
+	return E_VALID | ((uint32_t) depth << E_DEPTH_SHIFT) | value;
+    }
+    static inline int entry_depth(uint32_t e) {
+	return (e & E_DEPTH_MASK) >> E_DEPTH_SHIFT;
+    }
+    static inline uint64_t prefix_key(uint32_t addr, int len) {
+	return ((uint64_t) addr << 8) | len;
+    }
+
+    Table *alloc_table(uint32_t ngroups, ErrorHandler *errh);
+    static void free_table(Table *t);
+    void swap_table(Table *t);
+    void retire(Vector<IPRoute> &v);
+
+    int alloc_group(Table *t, uint32_t fill);
+    void free_group(Table *t, uint32_t g);
+    void maybe_collapse(Table *t, uint32_t i24);
+
+    int insert(Table *t, uint32_t addr, int depth, uint32_t idx);
+    void erase(Table *t, uint32_t addr, int depth, uint32_t sub);
+    uint32_t covering_entry(uint32_t addr, int depth) const;
+
+    int rebuild(const Vector<IPRoute> &v, ErrorHandler *errh);
+    int grow_routes(ErrorHandler *errh);
+    int load_table(const String &data, ErrorHandler *errh);
+
+    static int load_handler(const String &, Element *, void *,
+			    ErrorHandler *);
+    static int flush_handler(const String &, Element *, void *,
+			     ErrorHandler *);
+    static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -29,13 +29,22 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if CONFIG_LIBCLICK_TRACE
+#define UK_DEBUG_TRACE
+#endif
 #include "fromdevice.hh"
 
 #include <click/args.hh>
-#include <click/deque.hh>
 #include <click/error.hh>
+#include <click/handler.hh>
 #include <click/standard/scheduleinfo.hh>
 #include <click/task.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include <clicknet/tcp.h>
+#include <click_alloc.h>
+#include <click_cksum.h>
 #include <uk/netdev.h>
 
 #ifdef xmit
@@ -45,17 +54,21 @@
 #undef recv
 #endif
 
-#include <uk/alloc.h>
 #include <uk/netdev.h>
+#include <uk/trace.h>
 
-CLICK_DECLS
+UK_TRACEPOINT(trace_click_rx_intr, "elem=%u dev=%u", unsigned, unsigned);
+UK_TRACEPOINT(trace_click_rx_burst, "elem=%u n=%u", unsigned, unsigned);
+UK_TRACEPOINT(trace_click_rx, "elem=%u pkt=%lx len=%u",
+	      unsigned, unsigned long, unsigned);
+UK_TRACEPOINT(trace_click_rx_done, "elem=%u n=%u", unsigned, unsigned);
 
-#define DESC_COUNT 0x100
-#define BUFSIZE 2048
+CLICK_DECLS
 
 FromDevice::FromDevice()
-	: _task(this)
+	: _task(this), _gro_nflows(0), _nd(0)
 {
+	_rx_pending = 0;
 }
 
 FromDevice::~FromDevice()
@@ -65,106 +78,428 @@ FromDevice::~FromDevice()
 int
 FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+	uint16_t rx_ring, tx_ring, mtu;
+	uint32_t bufsize, recycle;
+	bool set[5] = { false, false, false, false, false };
+
 	_devid = 0;
+	_queue = 0;
+	_gro = false;
+	_gro_maxsize = 65535;
+	_gro_timeout = 0;
+	_gso_anno = -1;
+	_trace = false;
+	_batch_max = 32;
 
 	uk_pr_info("FromDevice::configure %p\n", this);
 	if (Args(conf, this, errh)
 			.read_p("DEVID", IntArg(), _devid)
+			.read("QUEUE", _queue)
+			.read("RX_RING", rx_ring).read_status(set[0])
+			.read("TX_RING", tx_ring).read_status(set[1])
+			.read("MTU", mtu).read_status(set[2])
+			.read("BUFSIZE", bufsize).read_status(set[3])
+			.read("GRO", _gro)
+			.read("GRO_MAXSIZE", _gro_maxsize)
+			.read("GRO_TIMEOUT", SecondsArg(6), _gro_timeout)
+			.read("GSO_ANNO", AnnoArg(2), _gso_anno)
+			.read("TRACE", _trace)
+			.read("RECYCLE", recycle).read_status(set[4])
+			.read("BATCH", _batch_max)
 			.complete() < 0)
 		return -1;
 
-	if (_devid < 0)
-		return errh->error("Device ID must be >= 0");
+	if (_gro_maxsize < 576 || _gro_maxsize > 65535)
+		return errh->error("GRO_MAXSIZE must be between 576 and 65535");
+	if (_batch_max < 1)
+		return errh->error("BATCH must be > 0");
+	if (!(_nd = NetDev::get(_devid, errh)))
+		return -1;
+	_dev = _nd->dev;
 
-	_dev = uk_netdev_get((unsigned int) _devid);
-	if (!_dev)
-		return errh->error("No such device %d", _devid);
-	uk_netdev_info_get(_dev, &_dev_info);
+	/* device settings from before there was NetDevice */
+	if (set[0] || set[1] || set[2] || set[3] || set[4]) {
+		NetDev nd(*_nd);
 
-	return 0;
+		if (_nd->owner)
+			return errh->error("RX_RING, TX_RING, MTU, BUFSIZE and RECYCLE of device %d belong to %s",
+					   _devid, _nd->owner->declaration().c_str());
+		if (set[0])
+			nd.rx_ring = rx_ring;
+		if (set[1])
+			nd.tx_ring = tx_ring;
+		if (set[2])
+			nd.mtu = mtu;
+		if (set[3])
+			nd.bufsize = bufsize;
+		if (set[4])
+			nd.recycle = recycle;
+		if (nd.check(errh) < 0)
+			return -1;
+		if (_nd->started)
+			errh->warning("Device %d is running already, its settings stay as they are", _devid);
+		else
+			*_nd = nd;
+	}
+	return _nd->attach_rx(_queue, rx_intr, this, errh);
 }
 
-extern "C" void
-click_fromdevice_rx_callback(struct uk_netdev *dev __unused, /* we have all
-				the information we need via the cookie */
-		uint16_t queue_id, void *cookie)
+void
+FromDevice::rx_intr(void *arg)
 {
-	FromDevice *fromdevice = (FromDevice *)cookie;
-
-	uk_pr_debug("FromDevice %p queue %u callback\n", cookie, queue_id);
-	fromdevice->take_packets();
+	static_cast<FromDevice *>(arg)->rx_interrupt();
 }
 
-uint16_t
-FromDevice::netdev_alloc_rxpkts(void *argp, struct uk_netbuf *pkts[],
-		uint16_t count)
+/* Runs on the device's dispatcher thread, not on a RouterThread: only
+ * note the interrupt, the task takes the packets on its own thread.
+ */
+void
+FromDevice::rx_interrupt()
 {
-	int i;
-
-	FromDevice *fd = static_cast<FromDevice *>(argp);
-	for (i = 0; i < count; ++i) {
-		pkts[i] = uk_netbuf_alloc_buf(uk_alloc_get_default(),
-				BUFSIZE, fd->_dev_info.ioalign, fd->_dev_info.nb_encap_rx, 0, NULL);
-		if (!pkts[i])
-			return i;
-		pkts[i]->len = BUFSIZE;
-	}
-	return count;
+	if (unlikely(_trace))
+		trace_click_rx_intr(eindex(), _devid);
+	_rx_pending = 1;
 }
 
 int
 FromDevice::initialize(ErrorHandler *errh)
 {
-	struct uk_netdev_info dinf;
-	struct uk_netdev_rxqueue_conf rx_conf;
-	struct uk_netdev_txqueue_conf tx_conf;
 	int rc;
 
-	uk_pr_info("FromDevice::initialize %p device %p state %d\n",
-			this, _dev, _dev->_data->state);
-	uk_netdev_info_get(_dev, &dinf);
-	rx_conf.s = uk_sched_current();
-	rx_conf.a = uk_alloc_get_default();
-	rx_conf.callback = click_fromdevice_rx_callback;
-	rx_conf.callback_cookie = (void *)(this);
-	rx_conf.alloc_rxpkts = &FromDevice::netdev_alloc_rxpkts;
-	rx_conf.alloc_rxpkts_argp = this;
-	if (uk_netdev_rxq_configure(_dev, 0, DESC_COUNT, &rx_conf))
-		return errh->error("Failed to set up RX queue for device %d", _devid);
-	tx_conf.a = uk_alloc_get_default();
-	if (uk_netdev_txq_configure(_dev, 0, DESC_COUNT, &tx_conf))
-		return errh->error("Failed to set up TX queue for device %d", _devid);
-	if (uk_netdev_start(_dev))
-		return errh->error("Failed to start device %d", _devid);
-	rc = uk_netdev_rxq_intr_enable(_dev, 0);
+	if (BatchElement::initialize(errh) < 0)
+		return -1;
+	if (_nd->start(errh) < 0)
+		return -1;
+	uk_pr_info("FromDevice::initialize %p device %p queue %u state %d\n",
+			this, _dev, _queue, _dev->_data->state);
+	if (_nd->intr) {
+		rc = uk_netdev_rxq_intr_enable(_dev, _queue);
 		if (rc < 0)
 			return errh->error("Failed to set up RX queue interrupt for device %d", _devid);
 		else if (rc > 0)
-			take_packets(); // empty the queue to enable interrupt
+			_rx_pending = 1; // empty the queue to enable interrupt
+	}
 	ScheduleInfo::initialize_task(this, &_task, errh);
 	_task.reschedule();
 	return 0;
 
 }
 
+void
+FromDevice::add_handlers()
+{
+	add_data_handlers("trace", Handler::f_read | Handler::f_write | Handler::f_checkbox, &_trace);
+}
+
 void
 FromDevice::cleanup(CleanupStage stage)
 {
-	if (stage >= CLEANUP_INITIALIZED) {
-		uk_netdev_rxq_intr_disable(_dev, 0);
+	if (_nd) {
+		if (stage >= CLEANUP_INITIALIZED && _nd->intr)
+			uk_netdev_rxq_intr_disable(_dev, _queue);
+		_nd->detach_rx(_queue, this);
+	}
+	for (int i = 0; i < _gro_nflows; ++i)
+		_gro_flows[i].p->kill();
+	_gro_nflows = 0;
+	_batch.kill();
+}
+
+void
+FromDevice::netbuf_destructor(unsigned char *, size_t, void *arg)
+{
+	NetDev::rx_release((struct uk_netbuf *) arg);
+}
+
+/* Single buffers become the packet's data buffer. Chains are copied into
+ * one packet since Click packets are contiguous.
+ */
+Packet *
+FromDevice::netbuf_to_packet(struct uk_netbuf *buf)
+{
+	WritablePacket *p;
+	struct uk_netbuf *nb;
+	unsigned char *d;
+
+	if (likely(!buf->next)) {
+		size_t headroom = (char *) buf->data - (char *) buf->buf;
+		p = Packet::make((unsigned char *) buf->data, buf->len,
+				netbuf_destructor, buf, headroom,
+				buf->buflen - headroom - buf->len);
+		if (!p)
+			NetDev::rx_release(buf);
+		return p;
+	}
+
+	p = Packet::make(NetDev::RX_HEADROOM, 0, uk_netbuf_len(buf), 0);
+	if (p) {
+		d = p->data();
+		UK_NETBUF_CHAIN_FOREACH(nb, buf) {
+			memcpy(d, nb->data, nb->len);
+			d += nb->len;
+		}
+	}
+	NetDev::rx_release(buf);
+	return p;
+}
+
+void
+FromDevice::push_out()
+{
+	unsigned n = _batch.count();
+
+	output_push_batch(0, _batch);
+	if (unlikely(_trace))
+		trace_click_rx_done(eindex(), n);
+}
+
+/* Locates the TCP header of an Ethernet frame carrying TCP over IPv4 or
+ * IPv6. end is where the IP packet ends; anything after it up to len is
+ * Ethernet padding.
+ */
+static bool
+gro_parse(const unsigned char *d, uint32_t len, uint16_t &l3, uint16_t &l4,
+	  uint16_t &hlen, uint32_t &end, bool &v6)
+{
+	uint16_t type;
+
+	l3 = sizeof(click_ether);
+	if (len < l3)
+		return false;
+	type = reinterpret_cast<const click_ether *>(d)->ether_type;
+	if (type == htons(ETHERTYPE_8021Q)) {
+		if (len < l3 + 4U)
+			return false;
+		type = *reinterpret_cast<const uint16_t *>(d + l3 + 2);
+		l3 += 4;
+	}
+
+	if (type == htons(ETHERTYPE_IP)) {
+		const click_ip *iph = reinterpret_cast<const click_ip *>(d + l3);
+		if (len < l3 + sizeof(click_ip) || iph->ip_p != IP_PROTO_TCP
+		    || iph->ip_hl < 5 || (iph->ip_off & htons(IP_MF | IP_OFFMASK)))
+			return false;
+		l4 = l3 + (iph->ip_hl << 2);
+		end = l3 + ntohs(iph->ip_len);
+		v6 = false;
+	} else if (type == htons(ETHERTYPE_IP6)) {
+		const click_ip6 *ip6 = reinterpret_cast<const click_ip6 *>(d + l3);
+		if (len < l3 + sizeof(click_ip6) || ip6->ip6_nxt != IP_PROTO_TCP)
+			return false;
+		l4 = l3 + sizeof(click_ip6);
+		end = l4 + ntohs(ip6->ip6_plen);
+		v6 = true;
+	} else
+		return false;
+
+	if (end > len || end < l4 + sizeof(click_tcp))
+		return false;
+	hlen = l4 + (reinterpret_cast<const click_tcp *>(d + l4)->th_off << 2);
+	return hlen >= l4 + sizeof(click_tcp) && hlen <= end;
+}
+
+/* Checks the TCP checksum of the segment between l4 and end */
+static bool
+gro_cksum_ok(const unsigned char *d, uint16_t l3, uint16_t l4, uint32_t end,
+	     bool v6)
+{
+	uint32_t l4len = end - l4;
+
+	return click_cksum_partial(d + l4, l4len,
+			click_cksum_pseudo(d + l3, v6, IP_PROTO_TCP, l4len)) == 0xFFFF;
+}
+
+/* Appends the payload of q to flow f if q continues it and carries the
+ * same headers apart from lengths, IDs, sequence number, checksums, window
+ * and PSH. Consumes q on success.
+ */
+bool
+FromDevice::gro_merge(GroFlow &f, Packet *q, uint32_t seq, uint32_t plen)
+{
+	const unsigned char *fd = f.p->data(), *qd = q->data();
+	const click_tcp *fth = reinterpret_cast<const click_tcp *>(fd + f.l4);
+	const click_tcp *qth = reinterpret_cast<const click_tcp *>(qd + f.l4);
+	WritablePacket *w;
+
+	if (seq != f.next_seq || plen > f.mss
+	    || f.p->length() - f.l3 + plen > _gro_maxsize)
+		return false;
+	if (memcmp(fd, qd, f.l3)
+	    || fth->th_ack != qth->th_ack
+	    || (fth->th_flags & ~TH_PUSH) != (qth->th_flags & ~TH_PUSH)
+	    || memcmp(fd + f.l4 + sizeof(click_tcp), qd + f.l4 + sizeof(click_tcp),
+		      f.hlen - f.l4 - sizeof(click_tcp)))
+		return false;
+	if (f.v6) {
+		/* version, traffic class, flow label; next header, hop limit */
+		if (memcmp(fd + f.l3, qd + f.l3, 4)
+		    || memcmp(fd + f.l3 + 6, qd + f.l3 + 6, 2))
+			return false;
+	} else {
+		const click_ip *fi = reinterpret_cast<const click_ip *>(fd + f.l3);
+		const click_ip *qi = reinterpret_cast<const click_ip *>(qd + f.l3);
+		if (fi->ip_tos != qi->ip_tos || fi->ip_off != qi->ip_off
+		    || fi->ip_ttl != qi->ip_ttl)
+			return false;
+	}
+
+	if (f.nsegs == 1) {
+		/* first merge: move into a buffer with room for the rest */
+		w = Packet::make(NetDev::RX_HEADROOM, fd, f.p->length(),
+				_gro_maxsize + f.l3 - f.p->length());
+		if (!w)
+			return false;
+		w->copy_annotations(f.p);
+		f.p->kill();
+		f.p = w;
+	}
+	w = f.p->put(plen);
+	memcpy(w->end_data() - plen, qd + f.hlen, plen);
+	reinterpret_cast<click_tcp *>(w->data() + f.l4)->th_win = qth->th_win;
+	reinterpret_cast<click_tcp *>(w->data() + f.l4)->th_flags |=
+		qth->th_flags & TH_PUSH;
+	f.p = w;
+	f.next_seq += plen;
+	f.nsegs++;
+	q->kill();
+	return true;
+}
+
+/* Fixes up the headers of a merged packet and pushes it */
+void
+FromDevice::gro_flush_flow(int i)
+{
+	GroFlow &f = _gro_flows[i];
+	Packet *p = f.p;
+
+	if (f.nsegs > 1) {
+		WritablePacket *w = p->uniqueify();
+		unsigned char *d = w->data();
+		uint32_t l4len = w->length() - f.l4;
+		click_tcp *th = reinterpret_cast<click_tcp *>(d + f.l4);
+
+		if (f.v6)
+			reinterpret_cast<click_ip6 *>(d + f.l3)->ip6_plen = htons(l4len);
+		else {
+			click_ip *iph = reinterpret_cast<click_ip *>(d + f.l3);
+			uint16_t old_len = iph->ip_len;
+			iph->ip_len = htons(w->length() - f.l3);
+			iph->ip_sum = click_cksum_adjust16(iph->ip_sum, old_len,
+							   iph->ip_len);
+		}
+		th->th_sum = 0;
+		th->th_sum = ~click_cksum_partial(d + f.l4, l4len,
+				click_cksum_pseudo(d + f.l3, f.v6, IP_PROTO_TCP, l4len));
+		if (_gso_anno >= 0)
+			w->set_anno_u16(_gso_anno, f.mss);
+		p = w;
+	}
+
+	/* keep the remaining flows in arrival order */
+	for (int j = i + 1; j < _gro_nflows; ++j)
+		_gro_flows[j - 1] = _gro_flows[j];
+	--_gro_nflows;
+	emit(p);
+}
+
+void
+FromDevice::gro_flush(bool all)
+{
+	Timestamp now;
+
+	if (!all && _gro_timeout)
+		now = Timestamp::now_steady();
+	while (_gro_nflows) {
+		if (!all && _gro_timeout
+		    && (now - _gro_flows[0].start).usecval() < _gro_timeout)
+			break;
+		gro_flush_flow(0);
+	}
+}
+
+/* Merges p into a held flow or holds it. Merged packets get a fresh
+ * checksum, so only segments whose checksum is known to be right are
+ * merged: csum_valid says the device checked it, otherwise it is checked
+ * here.
+ */
+void
+FromDevice::gro_receive(Packet *p, bool csum_valid)
+{
+	const unsigned char *d = p->data();
+	const click_tcp *th;
+	uint16_t l3, l4, hlen;
+	uint32_t seq, plen, end;
+	bool v6, eligible;
+	int i;
+
+	if (!gro_parse(d, p->length(), l3, l4, hlen, end, v6)) {
+		emit(p);
+		return;
 	}
+	th = reinterpret_cast<const click_tcp *>(d + l4);
+	seq = ntohl(th->th_seq);
+	plen = end - hlen;
+	eligible = plen && (th->th_flags & ~TH_PUSH) == TH_ACK
+		&& (v6 || l4 - l3 == sizeof(click_ip))
+		&& (csum_valid || gro_cksum_ok(d, l3, l4, end, v6));
+	/* merged payloads are appended at the end of the packet */
+	if (eligible && end < p->length())
+		p->take(p->length() - end);
+
+	/* same addresses and ports */
+	for (i = 0; i < _gro_nflows; ++i) {
+		const GroFlow &f = _gro_flows[i];
+		const unsigned char *fd = f.p->data();
+		if (f.l3 == l3 && f.l4 == l4 && f.v6 == v6
+		    && !memcmp(fd + l3 + (v6 ? 8 : 12), d + l3 + (v6 ? 8 : 12),
+			       v6 ? 32 : 8)
+		    && !memcmp(fd + l4, d + l4, 4))
+			break;
+	}
+
+	if (i < _gro_nflows) {
+		GroFlow &f = _gro_flows[i];
+		bool push = th->th_flags & TH_PUSH;
+		if (eligible && hlen == f.hlen && gro_merge(f, p, seq, plen)) {
+			if (push || plen < f.mss)
+				gro_flush_flow(i);
+			return;
+		}
+		gro_flush_flow(i);
+	}
+	if (!eligible || (th->th_flags & TH_PUSH)) {
+		emit(p);
+		return;
+	}
+
+	if (_gro_nflows == GRO_FLOWS)
+		gro_flush_flow(0);
+	GroFlow &f = _gro_flows[_gro_nflows++];
+	f.p = p;
+	if (_gro_timeout)
+		f.start = Timestamp::now_steady();
+	f.next_seq = seq + plen;
+	f.mss = plen;
+	f.nsegs = 1;
+	f.l3 = l3;
+	f.l4 = l4;
+	f.hlen = hlen;
+	f.v6 = v6;
 }
 
+/* Charges what it allocates to packets whichever thread it runs on */
 void
 FromDevice::take_packets()
 {
+	ClickMemScope mem(CLICK_MEM_PACKETS);
 	int ret;
 	int i = 0;
 	struct uk_netbuf *buf = NULL;
+	bool csum_valid = false;
 	Packet *p;
 
 	do {
-		ret = uk_netdev_rx_one(_dev, 0, &buf);
+		ret = uk_netdev_rx_one(_dev, _queue, &buf);
 		if (ret < 0)
 			UK_CRASH("error receiving packets in FromDevice");
 		if (uk_netdev_status_notready(ret)) {
@@ -173,11 +508,26 @@ FromDevice::take_packets()
 		}
 
 		++i;
-		p = Packet::make(0, buf->data, buf->len, 0);
+#ifdef UK_NETBUF_F_DATA_VALID
+		csum_valid = buf->flags & UK_NETBUF_F_DATA_VALID;
+#endif
+		p = netbuf_to_packet(buf);
+		if (!p)
+			continue;
 		p->set_timestamp_anno(Timestamp::now());
-		output(0).push(p); /* memcpy's pkt */
-		uk_netbuf_free(buf);
+		if (unlikely(_trace))
+			trace_click_rx(eindex(), (unsigned long) p, p->length());
+		if (_gro)
+			gro_receive(p, csum_valid);
+		else
+			emit(p);
 	} while (uk_netdev_status_more(ret));
+	if (_gro_nflows)
+		gro_flush(false);
+	if (!_batch.empty())
+		push_out();
+	if (unlikely(_trace))
+		trace_click_rx_burst(eindex(), i);
 	if (i)
 		uk_pr_debug("took %d packets from the queue\n", i);
 }
@@ -192,10 +542,27 @@ FromDevice::run_task(Task *)
 	req.tv_nsec = 1000000;
 	nanosleep(&req, NULL);
 	*/
+	if (!_nd->intr) {
+		take_packets();
+		_task.fast_reschedule();
+		return true;
+	}
+	if (_rx_pending.swap(0)) {
+		take_packets();
+		uk_sched_yield();
+		_task.fast_reschedule();
+		return true;
+	}
+	if (_gro_nflows) {
+		gro_flush(false);
+		if (!_batch.empty())
+			push_out();
+	}
 	uk_sched_yield();
 	_task.reschedule();
 	return false;
 }
 
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(BatchElement NetDevice)
 EXPORT_ELEMENT(FromDevice)
@@ -33,10 +33,13 @@
 #define CLICK_FROMDEVICE_HH
 
 #include <click/config.h>
-#include <click/deque.hh>
+#include <click/atomic.hh>
 #include <click/element.hh>
 #include <click/error.hh>
 #include <click/task.hh>
+#include <click/timestamp.hh>
+#include "batchelement.hh"
+#include "netdevice.hh"
 
 #include <uk/netdev.h>
 
@@ -46,7 +49,92 @@ extern "C" {
     struct uk_netdev;
 }
 
-class FromDevice : public Element {
+/*
+=c
+
+FromDevice(DEVID [, I<keywords> QUEUE, BATCH, GRO, TRACE, ...])
+
+=s netdevices
+
+reads packets from a Unikraft network device
+
+=d
+
+Pushes packets received on a receive queue of network device DEVID out of
+its output. The device is set up by a NetDevice element, or with its
+defaults if there is none.
+
+Packets are always taken and pushed by FromDevice's task, on the router
+thread it is scheduled on (see StaticThreadSched); with interrupts, the
+interrupt only tells the task that the queue has packets.
+
+Frames that fit into one receive buffer are handed to Click without
+copying. Frames the device splits over several buffers are copied into one
+packet.
+
+Keyword arguments are:
+
+=over 8
+
+=item QUEUE
+
+Integer. Receive queue to read. Default is 0.
+
+=item BATCH
+
+Integer. Received packets are handed downstream in batches of up to this
+many; elements that handle batches (see BatchElement) get each batch in
+one call, others one packet at a time. Default is 32.
+
+=item GRO
+
+Boolean. Merge consecutive in-order TCP segments of the same flow into one
+large packet before pushing it (generic receive offload). Only segments
+with nothing but ACK and PSH set, without IPv4 options, with a correct
+TCP checksum (checked in software unless the device has checked it) and
+with the same TCP options as the segments before them are merged; a
+segment with PSH set or a short payload ends the packet. Other packets,
+including padded ones like a bare FIN, are pushed right away, after any
+held packet of their own flow. Default is false.
+
+=item GRO_MAXSIZE
+
+Integer. Maximum IP packet size of a merged packet. Default is 65535.
+
+=item GRO_TIMEOUT
+
+Time in microseconds a merged packet may wait for more segments across
+receive bursts. Default is 0: everything is pushed at the end of the burst
+it was received in.
+
+=item GSO_ANNO
+
+Annotation offset. If given, merged packets have their segment size stored
+there as two bytes, so a ToDevice with the same GSO_ANNO can split them
+again.
+
+=item RX_RING, TX_RING, MTU, BUFSIZE, RECYCLE
+
+Device settings as for NetDevice, for configurations without a NetDevice
+element for DEVID.
+
+=item TRACE
+
+Boolean. Record receive interrupts and bursts, each packet's entry into the
+graph and the return of each batch as Unikraft tracepoints (needs
+LIBCLICK_TRACE).
+Default is false.
+
+=back
+
+=h trace read/write
+
+Whether tracing is on; can be changed at run time.
+
+=a NetDevice, ToDevice
+*/
+
+class FromDevice : public BatchElement {
 public:
     FromDevice();
     ~FromDevice();
@@ -54,24 +142,68 @@ public:
     const char *class_name() const { return "FromDevice"; }
     const char *port_count() const { return "0/1"; }
     const char *processing() const { return "/h"; }
-    int configure_phase() const { return CONFIGURE_PHASE_FIRST; }
+    int configure_phase() const { return CONFIGURE_PHASE_FIRST + 1; }
 
     int configure(Vector<String> &, ErrorHandler *);
     int initialize(ErrorHandler *);
     void cleanup(CleanupStage);
+    void add_handlers();
 
     bool run_task(Task *);
     void take_packets();
+    void rx_interrupt();
 
 private:
-    static uint16_t netdev_alloc_rxpkts(void *argp, struct uk_netbuf *pkts[], uint16_t count);
+    static void rx_intr(void *);
+    static void netbuf_destructor(unsigned char *, size_t, void *);
+    Packet *netbuf_to_packet(struct uk_netbuf *);
+
+    struct GroFlow {
+	Packet *p;
+	Timestamp start;
+	uint32_t next_seq;
+	uint16_t mss;
+	uint16_t nsegs;
+	uint16_t l3;
+	uint16_t l4;
+	uint16_t hlen;
+	bool v6;
+    };
+    enum { GRO_FLOWS = 8 };
+
+    inline void emit(Packet *);
+    void push_out();
+
+    void gro_receive(Packet *, bool csum_valid);
+    bool gro_merge(GroFlow &, Packet *, uint32_t seq, uint32_t plen);
+    void gro_flush_flow(int);
+    void gro_flush(bool all);
 
     Task _task;
-    Deque<Packet*> _deque;
     int _devid;
+    uint16_t _queue;
+    bool _gro;
+    uint32_t _gro_maxsize;
+    uint32_t _gro_timeout;
+    int _gso_anno;
+    GroFlow _gro_flows[GRO_FLOWS];
+    int _gro_nflows;
+    bool _trace;
+    atomic_uint32_t _rx_pending;	/* set by the receive interrupt */
+    uint32_t _batch_max;
+    PacketBatch _batch;
+    NetDev *_nd;
     struct uk_netdev *_dev;
-    struct uk_netdev_info _dev_info;
 };
 
+/* Queues p for the graph; full batches go out right away */
+inline void
+FromDevice::emit(Packet *p)
+{
+    _batch.append(p);
+    if (_batch.count() >= _batch_max)
+	push_out();
+}
+
 CLICK_ENDDECLS
 #endif
@@ -0,0 +1,231 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "generatorcheck.hh"
+#include "devicegenerator.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/timestamp.hh>
+
+#include <uk/essentials.h>
+
+CLICK_DECLS
+
+enum {
+	H_COUNT, H_LOST, H_LATE, H_UNSTAMPED, H_MIN, H_MAX, H_MEAN, H_RATE
+};
+
+/* The rate goes by the monotonic clock */
+static inline uint64_t
+now_ns()
+{
+	return Timestamp::now_steady().nsecval();
+}
+
+/* Latency by the wall clock, as DeviceGenerator stamps */
+static inline uint64_t
+stamp_ns()
+{
+	return Timestamp::now().nsecval();
+}
+
+GeneratorCheck::GeneratorCheck()
+{
+}
+
+GeneratorCheck::~GeneratorCheck()
+{
+}
+
+int
+GeneratorCheck::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	_offset = CLICK_GEN_STAMP_OFFSET;
+
+	if (Args(conf, this, errh)
+			.read("OFFSET", _offset)
+			.complete() < 0)
+		return -1;
+	return 0;
+}
+
+int
+GeneratorCheck::initialize(ErrorHandler *errh)
+{
+	if (BatchElement::initialize(errh) < 0)
+		return -1;
+	write_handler(String(), this, 0, errh);
+	return 0;
+}
+
+inline void
+GeneratorCheck::check(const Packet *p, uint64_t now)
+{
+	const click_gen_stamp *st;
+	uint64_t seq, lat;
+
+	if (unlikely(p->length() < _offset + sizeof(click_gen_stamp))) {
+		_unstamped++;
+		return;
+	}
+	st = reinterpret_cast<const click_gen_stamp *>(p->data() + _offset);
+	if (unlikely(st->magic != CLICK_GEN_STAMP_MAGIC)) {
+		_unstamped++;
+		return;
+	}
+
+	seq = st->seq;
+	if (unlikely(!_started)) {
+		_started = true;
+		_next_seq = seq;
+		_rate_ns = now_ns();
+	}
+	if (likely(seq == _next_seq))
+		_next_seq++;
+	else if (seq > _next_seq) {
+		_lost += seq - _next_seq;
+		_next_seq = seq + 1;
+	} else {
+		_late++;
+		if (_lost)
+			_lost--;
+	}
+
+	_count++;
+	lat = now > st->ns ? now - st->ns : 0;
+	_lat_sum += lat;
+	if (lat < _lat_min)
+		_lat_min = lat;
+	if (lat > _lat_max)
+		_lat_max = lat;
+}
+
+Packet *
+GeneratorCheck::simple_action(Packet *p)
+{
+	check(p, stamp_ns());
+	return p;
+}
+
+/* One clock read per batch */
+void
+GeneratorCheck::push_batch(int, PacketBatch &batch)
+{
+	uint64_t now = stamp_ns();
+
+	for (Packet *p = batch.first(); p; p = p->next())
+		check(p, now);
+	output_push_batch(0, batch);
+}
+
+void
+GeneratorCheck::pull_batch(int, unsigned max, PacketBatch &batch)
+{
+	PacketBatch got;
+	uint64_t now;
+
+	input_pull_batch(0, max, got);
+	if (got.empty())
+		return;
+	now = stamp_ns();
+	for (Packet *p = got.first(); p; p = p->next())
+		check(p, now);
+	batch.append(got);
+}
+
+String
+GeneratorCheck::read_handler(Element *e, void *thunk)
+{
+	GeneratorCheck *gc = static_cast<GeneratorCheck *>(e);
+	uint64_t now, dt, n;
+
+	switch ((intptr_t) thunk) {
+	case H_COUNT:
+		return String(gc->_count);
+	case H_LOST:
+		return String(gc->_lost);
+	case H_LATE:
+		return String(gc->_late);
+	case H_UNSTAMPED:
+		return String(gc->_unstamped);
+	case H_MIN:
+		return String(gc->_count ? gc->_lat_min : 0);
+	case H_MAX:
+		return String(gc->_lat_max);
+	case H_MEAN:
+		return String(gc->_count ? gc->_lat_sum / gc->_count : 0);
+	case H_RATE:
+		if (!gc->_started)
+			return String(0);
+		now = now_ns();
+		dt = now - gc->_rate_ns;
+		n = gc->_count - gc->_rate_count;
+		gc->_rate_ns = now;
+		gc->_rate_count = gc->_count;
+		return String(dt ? (uint64_t) ((double) n * 1000000000 / dt) : 0);
+	}
+	return String();
+}
+
+int
+GeneratorCheck::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	GeneratorCheck *gc = static_cast<GeneratorCheck *>(e);
+
+	gc->_started = false;
+	gc->_next_seq = 0;
+	gc->_count = gc->_lost = gc->_late = gc->_unstamped = 0;
+	gc->_lat_sum = gc->_lat_max = 0;
+	gc->_lat_min = ~0ULL;
+	gc->_rate_ns = 0;
+	gc->_rate_count = 0;
+	return 0;
+}
+
+void
+GeneratorCheck::add_handlers()
+{
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("lost", read_handler, H_LOST);
+	add_read_handler("late", read_handler, H_LATE);
+	add_read_handler("unstamped", read_handler, H_UNSTAMPED);
+	add_read_handler("min", read_handler, H_MIN);
+	add_read_handler("max", read_handler, H_MAX);
+	add_read_handler("mean", read_handler, H_MEAN);
+	add_read_handler("rate", read_handler, H_RATE);
+	add_write_handler("reset", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(BatchElement)
+EXPORT_ELEMENT(GeneratorCheck)
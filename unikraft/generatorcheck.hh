@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_GENERATORCHECK_HH
+#define CLICK_GENERATORCHECK_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include "batchelement.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+GeneratorCheck([I<keywords> OFFSET])
+
+=s counters
+
+counts lost packets and latency of DeviceGenerator traffic
+
+=d
+
+Reads the sequence number and send time that DeviceGenerator writes into
+its packets and passes all packets on unchanged. A sequence number beyond
+the next one expected counts the skipped ones as lost; one below it is
+late, and taken back from the lost count. Latency is the time between
+sending and arriving here, both taken from the wall clock. It is exact
+when the generator runs in the same image; across machines it is only as
+good as their clock synchronization, and it is counted as 0 where the
+receiver's clock is behind.
+
+The check keeps one sequence state, so it should see the stream of one
+generator on one thread. Packets without a stamp are counted separately.
+
+Keyword arguments are:
+
+=over 8
+
+=item OFFSET
+
+Integer. Offset of the stamp from the start of the packet. Default is 42,
+right after the UDP header of an Ethernet frame as DeviceGenerator builds
+it.
+
+=back
+
+=h count read-only
+
+Returns the number of stamped packets seen.
+
+=h lost read-only
+
+Returns the number of sequence numbers skipped and not seen later.
+
+=h late read-only
+
+Returns the number of packets arriving after a higher sequence number.
+
+=h unstamped read-only
+
+Returns the number of packets without a stamp.
+
+=h min, max, mean read-only
+
+Return the smallest, largest and average latency in nanoseconds.
+
+=h rate read-only
+
+Returns the rate of stamped packets in packets per second since the
+previous read, or since the first packet.
+
+=h reset write-only
+
+Clears all counters. The next packet starts a new sequence.
+
+=e
+
+  FromDevice(1) -> GeneratorCheck -> Discard;
+
+=a DeviceGenerator, LatencyProbe
+*/
+
+class GeneratorCheck : public BatchElement { public:
+
+    GeneratorCheck();
+    ~GeneratorCheck();
+
+    const char *class_name() const	{ return "GeneratorCheck"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void add_handlers();
+
+    Packet *simple_action(Packet *);
+    void push_batch(int, PacketBatch &);
+    void pull_batch(int, unsigned, PacketBatch &);
+
+  private:
+
+    uint32_t _offset;
+    bool _started;
+    uint64_t _next_seq;
+    uint64_t _count;
+    uint64_t _lost;
+    uint64_t _late;
+    uint64_t _unstamped;
+    uint64_t _lat_sum;
+    uint64_t _lat_min;
+    uint64_t _lat_max;
+    uint64_t _rate_ns;
+    uint64_t _rate_count;
+
+    inline void check(const Packet *, uint64_t now);
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
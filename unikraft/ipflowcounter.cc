@@ -0,0 +1,356 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ipflowcounter.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#if CONFIG_LIBCLICK_FLOWTABLE_SELFTEST
+#include <click/cycles.hh>
+#include <click/hashtable.hh>
+#endif
+
+#include <uk/essentials.h>
+#if CONFIG_LIBCLICK_FLOWTABLE_SELFTEST
+#include <click_tables.h>
+#include <uk/print.h>
+#endif
+
+CLICK_DECLS
+
+enum {
+	H_COUNT, H_TABLE, H_UNCLASSIFIED, H_OVERFLOW
+};
+
+IPFlowCounter::IPFlowCounter()
+	: _table(0)
+{
+}
+
+IPFlowCounter::~IPFlowCounter()
+{
+}
+
+int
+IPFlowCounter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	_max_flows = 0;
+	_buckets = 1024;
+
+	if (Args(conf, this, errh)
+			.read("MAX_FLOWS", _max_flows)
+			.read("BUCKETS", _buckets)
+			.complete() < 0)
+		return -1;
+	if (!_buckets || _buckets > (1U << 28))
+		return errh->error("BUCKETS out of range");
+	return 0;
+}
+
+int
+IPFlowCounter::initialize(ErrorHandler *errh)
+{
+	if (BatchElement::initialize(errh) < 0)
+		return -1;
+	if (!(_table = new Table(_buckets)))
+		return errh->error("out of memory");
+	_unclassified = 0;
+	_overflow = 0;
+	return 0;
+}
+
+void
+IPFlowCounter::cleanup(CleanupStage)
+{
+	delete _table;
+	_table = 0;
+}
+
+/* Ports in network byte order, as IPFlowID keeps them */
+inline bool
+IPFlowCounter::flow_of(const Packet *p, IPFlowID &f)
+{
+	const click_ip *iph;
+	uint16_t sport = 0, dport = 0;
+
+	if (unlikely(!p->has_network_header()))
+		return false;
+	iph = p->ip_header();
+	if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+	    && IP_FIRSTFRAG(iph) && p->transport_length() >= 4) {
+		const click_udp *uh = p->udp_header();
+		sport = uh->uh_sport;
+		dport = uh->uh_dport;
+	}
+	f = IPFlowID(iph->ip_src, sport, iph->ip_dst, dport);
+	return true;
+}
+
+/* Adds a packet of flow f, which may be new */
+inline void
+IPFlowCounter::count(const IPFlowID &f, uint32_t len)
+{
+	Counts *c = _table->find(f);
+
+	if (!c && ((_max_flows && _table->size() >= _max_flows)
+		   || !(c = _table->find_insert(f, Counts())))) {
+		_overflow++;
+		return;
+	}
+	c->packets++;
+	c->bytes += len;
+}
+
+/* Looks up the flows of up to BURST_MAX packets at a time, so their
+ * buckets are fetched together. Entries never move, so the counts found
+ * stay valid while new flows of the same burst are inserted.
+ */
+void
+IPFlowCounter::count_batch(Packet *p)
+{
+	IPFlowID keys[Table::BURST_MAX];
+	Counts *counts[Table::BURST_MAX];
+	uint32_t lens[Table::BURST_MAX];
+	int n;
+
+	while (p) {
+		for (n = 0; p && n < Table::BURST_MAX; p = p->next()) {
+			if (unlikely(!flow_of(p, keys[n]))) {
+				_unclassified++;
+				continue;
+			}
+			lens[n++] = p->length();
+		}
+		_table->find_burst(keys, counts, n);
+		for (int i = 0; i < n; ++i)
+			if (likely(counts[i] != 0)) {
+				counts[i]->packets++;
+				counts[i]->bytes += lens[i];
+			} else
+				count(keys[i], lens[i]);
+	}
+	if (unlikely(_table->resizing()))
+		_table->resize_step();
+}
+
+Packet *
+IPFlowCounter::simple_action(Packet *p)
+{
+	IPFlowID f;
+
+	if (unlikely(!flow_of(p, f)))
+		_unclassified++;
+	else
+		count(f, p->length());
+	if (unlikely(_table->resizing()))
+		_table->resize_step();
+	return p;
+}
+
+void
+IPFlowCounter::push_batch(int, PacketBatch &batch)
+{
+	count_batch(batch.first());
+	output_push_batch(0, batch);
+}
+
+void
+IPFlowCounter::pull_batch(int, unsigned max, PacketBatch &batch)
+{
+	PacketBatch got;
+
+	input_pull_batch(0, max, got);
+	count_batch(got.first());
+	batch.append(got);
+}
+
+String
+IPFlowCounter::read_handler(Element *e, void *thunk)
+{
+	IPFlowCounter *fc = static_cast<IPFlowCounter *>(e);
+	StringAccum sa;
+
+	switch ((intptr_t) thunk) {
+	case H_COUNT:
+		return String((uint64_t) fc->_table->size());
+	case H_TABLE:
+		for (Table::iterator it = fc->_table->begin(); it.live(); ++it) {
+			const IPFlowID &f = it.key();
+			sa << f.saddr() << ' ' << (unsigned) ntohs(f.sport())
+			   << ' ' << f.daddr() << ' '
+			   << (unsigned) ntohs(f.dport()) << ' '
+			   << it.value().packets << ' ' << it.value().bytes
+			   << '\n';
+		}
+		return sa.take_string();
+	case H_UNCLASSIFIED:
+		return String(fc->_unclassified);
+	case H_OVERFLOW:
+		return String(fc->_overflow);
+	}
+	return String();
+}
+
+int
+IPFlowCounter::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	IPFlowCounter *fc = static_cast<IPFlowCounter *>(e);
+
+	fc->_table->clear();
+	fc->_unclassified = 0;
+	fc->_overflow = 0;
+	return 0;
+}
+
+void
+IPFlowCounter::add_handlers()
+{
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("table", read_handler, H_TABLE);
+	add_read_handler("unclassified", read_handler, H_UNCLASSIFIED);
+	add_read_handler("overflow", read_handler, H_OVERFLOW);
+	add_write_handler("reset", write_handler, 0, Handler::BUTTON);
+}
+
+#if CONFIG_LIBCLICK_FLOWTABLE_SELFTEST
+static uint32_t
+selftest_rand(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* Runs random inserts, updates, erases and lookups on a CuckooFlowTable
+ * and Click's HashTable side by side, starting from a table small enough
+ * to grow, stash and move buckets many times over. Then compares the
+ * contents both ways and times lookups of every flow.
+ */
+static int
+flowtable_selftest(int nflows)
+{
+	typedef CuckooFlowTable<IPFlowID, uint32_t> Cuckoo;
+	Cuckoo t(1);
+	HashTable<IPFlowID, uint32_t> ref;
+	Vector<IPFlowID> keys;
+	Vector<uint32_t *> found;
+	uint32_t state = 0x9E3779B9;
+	click_cycles_t c0, c1, c2, c3, c4;
+	size_t live = 0;
+	int errors = 0;
+
+	for (int i = 0; i < nflows; ++i)
+		keys.push_back(IPFlowID(IPAddress(selftest_rand(&state)),
+					selftest_rand(&state),
+					IPAddress(selftest_rand(&state)),
+					selftest_rand(&state)));
+
+	for (int i = 0; i < nflows * 4; ++i) {
+		const IPFlowID &k = keys[selftest_rand(&state) % nflows];
+		uint32_t op = selftest_rand(&state) & 7, v = selftest_rand(&state);
+		uint32_t *a, *b;
+
+		if (op < 5) {
+			if (!t.set(k, v) && ++errors <= 8)
+				uk_pr_err("flowtable selftest: insert failed\n");
+			ref.set(k, v);
+		} else if (op == 5) {
+			if (t.erase(k) != (ref.erase(k) != 0) && ++errors <= 8)
+				uk_pr_err("flowtable selftest: erase mismatch\n");
+		} else {
+			a = t.find(k);
+			b = ref.get_pointer(k);
+			if ((!a != !b || (a && *a != *b)) && ++errors <= 8)
+				uk_pr_err("flowtable selftest: %s: lookup mismatch\n",
+					  k.unparse().c_str());
+		}
+		if (t.resizing() && (i & 1))
+			t.resize_step();
+	}
+
+	for (Cuckoo::iterator it = t.begin(); it.live(); ++it, ++live) {
+		uint32_t *b = ref.get_pointer(it.key());
+		if ((!b || *b != it.value()) && ++errors <= 8)
+			uk_pr_err("flowtable selftest: %s: stale entry\n",
+				  it.key().unparse().c_str());
+	}
+	if ((live != t.size() || t.size() != ref.size()) && ++errors <= 8)
+		uk_pr_err("flowtable selftest: %lu entries, size %lu, HashTable %lu\n",
+			  (unsigned long) live, (unsigned long) t.size(),
+			  (unsigned long) ref.size());
+
+	found.resize(nflows, 0);
+	c0 = click_get_cycles();
+	t.find_burst(keys.begin(), found.begin(), nflows);
+	c1 = click_get_cycles();
+	for (int i = 0; i < nflows; ++i) {
+		uint32_t *b = ref.get_pointer(keys[i]);
+		if ((!found[i] != !b || (b && *found[i] != *b)) && ++errors <= 8)
+			uk_pr_err("flowtable selftest: %s: burst lookup mismatch\n",
+				  keys[i].unparse().c_str());
+	}
+	c2 = click_get_cycles();
+	for (int i = 0; i < nflows; ++i)
+		found[i] = t.find(keys[i]);
+	c3 = click_get_cycles();
+	for (int i = 0; i < nflows; ++i)
+		found[i] = ref.get_pointer(keys[i]);
+	c4 = click_get_cycles();
+
+	uk_pr_info("flowtable selftest: %d keys, %lu flows in %u buckets, %d mismatches\n",
+		   nflows, (unsigned long) t.size(), t.bucket_count(), errors);
+	uk_pr_info("flowtable selftest: cycles per lookup: cuckoo %lu, burst %lu, HashTable %lu\n",
+		   (unsigned long) ((c3 - c2) / nflows),
+		   (unsigned long) ((c1 - c0) / nflows),
+		   (unsigned long) ((c4 - c3) / nflows));
+	return errors;
+}
+#endif /* CONFIG_LIBCLICK_FLOWTABLE_SELFTEST */
+
+CLICK_ENDDECLS
+
+#if CONFIG_LIBCLICK_FLOWTABLE_SELFTEST
+int
+click_flowtable_selftest(void)
+{
+	CLICK_USING_DECLS
+	return flowtable_selftest(CONFIG_LIBCLICK_FLOWTABLE_SELFTEST_FLOWS);
+}
+#endif
+ELEMENT_REQUIRES(BatchElement)
+EXPORT_ELEMENT(IPFlowCounter)
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_IPFLOWCOUNTER_HH
+#define CLICK_IPFLOWCOUNTER_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/ipflowid.hh>
+#include "batchelement.hh"
+#include "cuckooflowtable.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+IPFlowCounter([I<keywords> MAX_FLOWS, BUCKETS])
+
+=s counters
+
+counts packets and bytes per IP flow
+
+=d
+
+Counts the packets and bytes of every flow, keyed by source and destination
+address and port, and passes all packets on unchanged. Packets need their
+IP header annotation, as set by CheckIPHeader or MarkIPHeader; others are
+counted as unclassified. Ports are taken from TCP and UDP headers of first
+fragments only and are 0 otherwise. The protocol is not part of the key.
+
+Flows are kept in a CuckooFlowTable, and a batch looks up all its flows at
+once with prefetching. The table grows in small steps with every batch, so
+forwarding does not stall on a resize.
+
+Keyword arguments are:
+
+=over 8
+
+=item MAX_FLOWS
+
+Integer. Packets of new flows are not counted once this many flows are
+known, only added to the overflow count. 0 means no limit. Default is 0.
+
+=item BUCKETS
+
+Integer. Initial number of buckets of eight flows, rounded up to a power of
+two. Default is 1024.
+
+=back
+
+=h count read-only
+
+Returns the number of flows.
+
+=h table read-only
+
+Returns one line per flow: source address and port, destination address and
+port, packets and bytes.
+
+=h unclassified read-only
+
+Returns the number of packets without an IP header annotation.
+
+=h overflow read-only
+
+Returns the number of packets not counted because of MAX_FLOWS.
+
+=h reset write-only
+
+Forgets all flows and clears the counters.
+
+=e
+
+  FromDevice(0) -> CheckIPHeader(14) -> IPFlowCounter -> ToDevice(1);
+
+=a AggregateIPFlows, CuckooFlowTable
+*/
+
+class IPFlowCounter : public BatchElement { public:
+
+    IPFlowCounter();
+    ~IPFlowCounter();
+
+    const char *class_name() const	{ return "IPFlowCounter"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    Packet *simple_action(Packet *);
+    void push_batch(int, PacketBatch &);
+    void pull_batch(int, unsigned, PacketBatch &);
+
+  private:
+
+    struct Counts {
+	uint64_t packets;
+	uint64_t bytes;
+	Counts(uint64_t p = 0, uint64_t b = 0) : packets(p), bytes(b) { }
+    };
+
+    typedef CuckooFlowTable<IPFlowID, Counts> Table;
+
+    Table *_table;
+    uint32_t _max_flows;
+    uint32_t _buckets;
+    uint64_t _unclassified;
+    uint64_t _overflow;
+
+    static inline bool flow_of(const Packet *, IPFlowID &);
+    inline void count(const IPFlowID &, uint32_t len);
+    void count_batch(Packet *);
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,392 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "latencyprobe.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/master.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+
+#include <string.h>
+
+#include <uk/essentials.h>
+
+CLICK_DECLS
+
+#define HIST_ALIGN 64
+
+enum {
+	H_COUNT, H_MIN, H_MAX, H_MEAN, H_P50, H_P90, H_P99, H_P999, H_P9999,
+	H_SUMMARY, H_UNSTAMPED
+};
+
+static const double summary_pct[] = { 50, 90, 99, 99.9, 99.99 };
+
+LatencyProbe::LatencyProbe()
+	: _mem(0), _hists(0)
+{
+}
+
+LatencyProbe::~LatencyProbe()
+{
+}
+
+int
+LatencyProbe::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	_class_anno = -1;
+	_nclasses = 0;
+	_precision = 5;
+
+	if (Args(conf, this, errh)
+			.read("CLASS_ANNO", AnnoArg(1), _class_anno)
+			.read("CLASSES", _nclasses)
+			.read("PRECISION", _precision)
+			.complete() < 0)
+		return -1;
+
+	if (!_nclasses)
+		_nclasses = _class_anno >= 0 ? 256 : 1;
+	if (_nclasses < 1 || _nclasses > 256)
+		return errh->error("CLASSES must be between 1 and 256");
+	if (_precision < 1 || _precision > 10)
+		return errh->error("PRECISION must be between 1 and 10");
+
+	/* exact values below 2^P, then 2^P buckets per power of two */
+	_nbuckets = (65 - _precision) << _precision;
+	_hist_size = sizeof(Hist) + _nbuckets * sizeof(uint64_t);
+	_hist_size = (_hist_size + HIST_ALIGN - 1) & ~(size_t) (HIST_ALIGN - 1);
+	return 0;
+}
+
+int
+LatencyProbe::initialize(ErrorHandler *errh)
+{
+	if (BatchElement::initialize(errh) < 0)
+		return -1;
+	_nthreads = master()->nthreads();
+	_mem = new char[_nthreads * _nclasses * _hist_size + HIST_ALIGN];
+	if (!_mem)
+		return errh->error("out of memory");
+	_hists = (char *) (((uintptr_t) _mem + HIST_ALIGN - 1)
+			   & ~(uintptr_t) (HIST_ALIGN - 1));
+	write_handler(String(), this, 0, errh);
+	return 0;
+}
+
+void
+LatencyProbe::cleanup(CleanupStage)
+{
+	delete[] _mem;
+	_mem = _hists = 0;
+}
+
+inline int
+LatencyProbe::bucket_of(uint64_t ns) const
+{
+	int e;
+
+	if (ns < (1ULL << _precision))
+		return ns;
+	e = 63 - __builtin_clzll(ns);
+	return ((e - _precision + 1) << _precision)
+		| ((ns >> (e - _precision)) & ((1U << _precision) - 1));
+}
+
+/* Highest latency falling into bucket b */
+inline uint64_t
+LatencyProbe::bucket_value(int b) const
+{
+	int shift = (b >> _precision) - 1;
+	uint64_t m = b & ((1U << _precision) - 1);
+
+	if (shift < 0)
+		return m;
+	return (((1ULL << _precision) + m + 1) << shift) - 1;
+}
+
+inline void
+LatencyProbe::record(int thread, const Packet *p, const Timestamp &now)
+{
+	const Timestamp &ts = p->timestamp_anno();
+	int cls = 0;
+	int64_t ns;
+	Hist *h;
+
+	if (_class_anno >= 0) {
+		cls = p->anno_u8(_class_anno);
+		if (cls >= _nclasses)
+			cls = _nclasses - 1;
+	}
+	h = hist(thread, cls);
+	if (unlikely(!ts)) {
+		h->unstamped++;
+		return;
+	}
+	ns = (now - ts).nsecval();
+	if (unlikely(ns < 0))
+		ns = 0;
+	h->count++;
+	h->sum += ns;
+	if ((uint64_t) ns < h->min)
+		h->min = ns;
+	if ((uint64_t) ns > h->max)
+		h->max = ns;
+	h->bucket[bucket_of(ns)]++;
+}
+
+inline int
+LatencyProbe::thread() const
+{
+	return click_current_cpu_id() % _nthreads;
+}
+
+Packet *
+LatencyProbe::simple_action(Packet *p)
+{
+	record(thread(), p, Timestamp::now());
+	return p;
+}
+
+/* One clock read per batch */
+void
+LatencyProbe::push_batch(int, PacketBatch &batch)
+{
+	Timestamp now = Timestamp::now();
+	int t = thread();
+
+	for (Packet *p = batch.first(); p; p = p->next())
+		record(t, p, now);
+	output_push_batch(0, batch);
+}
+
+void
+LatencyProbe::pull_batch(int, unsigned max, PacketBatch &batch)
+{
+	PacketBatch got;
+	Timestamp now;
+	int t;
+
+	input_pull_batch(0, max, got);
+	if (got.empty())
+		return;
+	now = Timestamp::now();
+	t = thread();
+	for (Packet *p = got.first(); p; p = p->next())
+		record(t, p, now);
+	batch.append(got);
+}
+
+/* Sums class cls over all threads into out, or all classes if cls < 0 */
+void
+LatencyProbe::merge(int cls, Hist *out) const
+{
+	memset(out, 0, _hist_size);
+	out->min = ~0ULL;
+	for (int t = 0; t < _nthreads; ++t)
+		for (int c = 0; c < _nclasses; ++c) {
+			const Hist *h = hist(t, c);
+
+			if (cls >= 0 && c != cls)
+				continue;
+			out->count += h->count;
+			out->sum += h->sum;
+			out->unstamped += h->unstamped;
+			if (h->min < out->min)
+				out->min = h->min;
+			if (h->max > out->max)
+				out->max = h->max;
+			for (int b = 0; b < _nbuckets; ++b)
+				out->bucket[b] += h->bucket[b];
+		}
+	if (!out->count)
+		out->min = 0;
+}
+
+uint64_t
+LatencyProbe::percentile(const Hist *h, double p) const
+{
+	uint64_t rank, seen = 0;
+
+	if (!h->count)
+		return 0;
+	rank = (uint64_t) (h->count * p / 100.0 + 0.5);
+	if (rank < 1)
+		rank = 1;
+	for (int b = 0; b < _nbuckets; ++b) {
+		seen += h->bucket[b];
+		if (seen >= rank) {
+			uint64_t v = bucket_value(b);
+			return v < h->max ? v : h->max;
+		}
+	}
+	return h->max;
+}
+
+String
+LatencyProbe::read_handler(Element *e, void *thunk)
+{
+	LatencyProbe *lp = static_cast<LatencyProbe *>(e);
+	int what = (intptr_t) thunk;
+	Hist *h = reinterpret_cast<Hist *>(new char[lp->_hist_size]);
+	StringAccum sa;
+
+	if (!h)
+		return String();
+	if (what != H_SUMMARY)
+		lp->merge(-1, h);
+
+	switch (what) {
+	case H_COUNT:
+		sa << h->count;
+		break;
+	case H_MIN:
+		sa << h->min;
+		break;
+	case H_MAX:
+		sa << h->max;
+		break;
+	case H_MEAN:
+		sa << (h->count ? h->sum / h->count : 0);
+		break;
+	case H_P50: case H_P90: case H_P99: case H_P999: case H_P9999:
+		sa << lp->percentile(h, summary_pct[what - H_P50]);
+		break;
+	case H_UNSTAMPED:
+		sa << h->unstamped;
+		break;
+	case H_SUMMARY:
+		sa.snprintf(128, "%-5s %12s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+			    "class", "count", "min", "mean", "p50", "p90",
+			    "p99", "p99.9", "p99.99", "max");
+		for (int c = 0; c < lp->_nclasses; ++c) {
+			lp->merge(c, h);
+			if (!h->count)
+				continue;
+			sa.snprintf(64, "%-5d %12llu %10llu %10llu", c,
+				    (unsigned long long) h->count,
+				    (unsigned long long) h->min,
+				    (unsigned long long) (h->sum / h->count));
+			for (size_t i = 0; i < sizeof(summary_pct) / sizeof(summary_pct[0]); ++i)
+				sa.snprintf(16, " %10llu", (unsigned long long)
+					    lp->percentile(h, summary_pct[i]));
+			sa.snprintf(16, " %10llu\n", (unsigned long long) h->max);
+		}
+		break;
+	}
+	delete[] reinterpret_cast<char *>(h);
+	return sa.take_string();
+}
+
+/* "percentile P [CLASS]" and "histogram [CLASS]" */
+int
+LatencyProbe::param_handler(int, String &s, Element *e, const Handler *handler,
+			    ErrorHandler *errh)
+{
+	LatencyProbe *lp = static_cast<LatencyProbe *>(e);
+	bool is_pct = handler->read_user_data() != 0;
+	int cls = -1;
+	double pct = 0;
+	Hist *h;
+	StringAccum sa;
+
+	if (is_pct) {
+		if (Args(e, errh).push_back_words(s)
+				.read_mp("P", pct)
+				.read_p("CLASS", cls)
+				.complete() < 0)
+			return -1;
+		if (pct < 0 || pct > 100)
+			return errh->error("percentile must be between 0 and 100");
+	} else if (Args(e, errh).push_back_words(s)
+			.read_p("CLASS", cls)
+			.complete() < 0)
+		return -1;
+	if (cls >= lp->_nclasses)
+		return errh->error("no class %d", cls);
+
+	h = reinterpret_cast<Hist *>(new char[lp->_hist_size]);
+	if (!h)
+		return errh->error("out of memory");
+	lp->merge(cls, h);
+	if (is_pct)
+		sa << lp->percentile(h, pct);
+	else
+		for (int b = 0; b < lp->_nbuckets; ++b)
+			if (h->bucket[b])
+				sa << lp->bucket_value(b) << ' ' << h->bucket[b] << '\n';
+	delete[] reinterpret_cast<char *>(h);
+	s = sa.take_string();
+	return 0;
+}
+
+int
+LatencyProbe::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	LatencyProbe *lp = static_cast<LatencyProbe *>(e);
+
+	for (int t = 0; t < lp->_nthreads; ++t)
+		for (int c = 0; c < lp->_nclasses; ++c) {
+			Hist *h = lp->hist(t, c);
+
+			memset(h, 0, lp->_hist_size);
+			h->min = ~0ULL;
+		}
+	return 0;
+}
+
+void
+LatencyProbe::add_handlers()
+{
+	add_read_handler("count", read_handler, H_COUNT);
+	add_read_handler("min", read_handler, H_MIN);
+	add_read_handler("max", read_handler, H_MAX);
+	add_read_handler("mean", read_handler, H_MEAN);
+	add_read_handler("p50", read_handler, H_P50);
+	add_read_handler("p90", read_handler, H_P90);
+	add_read_handler("p99", read_handler, H_P99);
+	add_read_handler("p999", read_handler, H_P999);
+	add_read_handler("p9999", read_handler, H_P9999);
+	add_read_handler("summary", read_handler, H_SUMMARY);
+	add_read_handler("unstamped", read_handler, H_UNSTAMPED);
+	set_handler("percentile", Handler::f_read | Handler::f_read_param,
+		    param_handler, (void *) 1);
+	set_handler("histogram", Handler::f_read | Handler::f_read_param,
+		    param_handler, (void *) 0);
+	add_write_handler("reset", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(BatchElement)
+EXPORT_ELEMENT(LatencyProbe)
@@ -0,0 +1,191 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_LATENCYPROBE_HH
+#define CLICK_LATENCYPROBE_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+#include "batchelement.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+LatencyProbe([I<keywords> CLASS_ANNO, CLASSES, PRECISION])
+
+=s counters
+
+records how long packets took since they were received
+
+=d
+
+Records, for every packet passing through, the time since its timestamp
+annotation was set. FromDevice stamps every packet it receives, so a
+LatencyProbe placed just before ToDevice measures ingress-to-egress
+forwarding latency, including the time spent in queues. Packets without a
+timestamp are passed on and counted separately.
+
+Latencies are kept in nanoseconds in a log-linear histogram, as in HDR
+Histogram: every power of two is split into 2^PRECISION equal buckets, so
+recorded values are exact up to 2^PRECISION ns and carry a relative error
+of less than 2^-PRECISION above. Recording costs a clock read per push or
+pull (one per batch with BatchElement neighbours) and an increment.
+
+Each router thread records into histograms of its own, so the probe can
+sit where several threads pass packets; handlers merge them on reading.
+
+Keyword arguments are:
+
+=over 8
+
+=item CLASS_ANNO
+
+Annotation offset of a one-byte flow class, e.g. the paint annotation set
+by Paint or a classifier. Each class gets its own histogram. By default
+all packets fall into class 0.
+
+=item CLASSES
+
+Integer. Number of classes, at most 256. Packets whose class is out of
+range count towards the last class. Default is 1, or 256 with CLASS_ANNO.
+
+=item PRECISION
+
+Integer between 1 and 10: bits of each power of two resolved. Default is
+5, about 3% relative error.
+
+=back
+
+=h count read-only
+
+Returns the number of packets recorded, over all classes.
+
+=h min, max, mean read-only
+
+Return the smallest, largest and average latency in nanoseconds, over all
+classes.
+
+=h p50, p90, p99, p999, p9999 read-only
+
+Return the given percentile of the latency in nanoseconds, over all
+classes.
+
+=h percentile read-only with parameter
+
+Takes "P [CLASS]" and returns the P-th percentile in nanoseconds, over all
+classes or in class CLASS.
+
+=h summary read-only
+
+Returns one line per class that recorded packets: class, count, min,
+mean, p50, p90, p99, p99.9, p99.99 and max, in nanoseconds.
+
+=h histogram read-only with parameter
+
+Returns the nonempty buckets, of class CLASS if given, as lines of the
+highest latency in the bucket and its packet count.
+
+=h unstamped read-only
+
+Returns the number of packets that had no timestamp.
+
+=h reset write-only
+
+Clears all histograms. Packets recorded while resetting may survive it.
+
+=e
+
+  FromDevice(0) -> ... -> Paint(1) -> ... -> LatencyProbe(CLASS_ANNO PAINT, CLASSES 4) -> ToDevice(0)
+
+=a FromDevice, ToDevice, Paint
+*/
+
+class LatencyProbe : public BatchElement { public:
+
+    LatencyProbe();
+    ~LatencyProbe();
+
+    const char *class_name() const	{ return "LatencyProbe"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    Packet *simple_action(Packet *);
+    void push_batch(int, PacketBatch &);
+    void pull_batch(int, unsigned, PacketBatch &);
+
+  private:
+
+    /* One histogram per thread and class, padded to its own cache lines */
+    struct Hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint64_t unstamped;
+	uint64_t bucket[0];
+    };
+
+    int _class_anno;
+    int _nclasses;
+    int _precision;
+    int _nbuckets;
+    size_t _hist_size;
+    int _nthreads;
+    char *_mem;
+    char *_hists;
+
+    Hist *hist(int thread, int cls) const {
+	return reinterpret_cast<Hist *>(_hists + (thread * _nclasses + cls) * _hist_size);
+    }
+    inline int bucket_of(uint64_t ns) const;
+    inline uint64_t bucket_value(int b) const;
+    inline int thread() const;
+    inline void record(int thread, const Packet *, const Timestamp &now);
+    void merge(int cls, Hist *) const;
+    uint64_t percentile(const Hist *, double p) const;
+
+    static String read_handler(Element *, void *);
+    static int param_handler(int, String &, Element *, const Handler *,
+			     ErrorHandler *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
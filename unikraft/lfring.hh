@@ -0,0 +1,278 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_LFRING_HH
+#define CLICK_LFRING_HH
+
+#include <click/config.h>
+#include <click/atomic.hh>
+#include <click/glue.hh>
+#include <errno.h>
+
+CLICK_DECLS
+
+#define LFRING_ALIGN __attribute__((aligned(64)))
+
+/** @class SPSCRing
+ * @brief Lock-free ring for one producer thread and one consumer thread.
+ *
+ * Capacity is rounded up to a power of two. Producer and consumer state
+ * live on separate cache lines, and each side keeps a copy of the other
+ * side's index that it only refreshes when the ring looks full (producer)
+ * or empty (consumer), so in steady state neither side reads a line the
+ * other one writes for every element. Burst operations publish their
+ * index once per burst.
+ */
+template <typename T>
+class SPSCRing { public:
+
+    SPSCRing()
+	: _ring(0), _mask(0) {
+	_p.tail = _p.head_cache = 0;
+	_c.head = _c.tail_cache = 0;
+    }
+    ~SPSCRing()				{ delete[] _ring; }
+
+    int initialize(uint32_t capacity);
+
+    uint32_t capacity() const		{ return _mask + 1; }
+    inline uint32_t size() const;
+    inline bool empty() const		{ return size() == 0; }
+
+    inline uint32_t enqueue_burst(const T *v, uint32_t n);
+    inline uint32_t dequeue_burst(T *v, uint32_t n);
+    inline bool enqueue(const T &x)	{ return enqueue_burst(&x, 1); }
+    inline bool dequeue(T &x)		{ return dequeue_burst(&x, 1); }
+
+  private:
+
+    struct {
+	uint32_t tail;
+	uint32_t head_cache;
+    } _p LFRING_ALIGN;
+    struct {
+	uint32_t head;
+	uint32_t tail_cache;
+    } _c LFRING_ALIGN;
+    T *_ring LFRING_ALIGN;
+    uint32_t _mask;
+
+    SPSCRing(const SPSCRing<T> &);
+    SPSCRing<T> &operator=(const SPSCRing<T> &);
+
+};
+
+/** @class MPSCRing
+ * @brief Lock-free ring for any number of producers and one consumer.
+ *
+ * Producers reserve slots with one compare-and-swap per burst, fill them,
+ * and then publish in reservation order. The consumer side is the same as
+ * SPSCRing's.
+ */
+template <typename T>
+class MPSCRing { public:
+
+    MPSCRing()
+	: _ring(0), _mask(0) {
+	_p.head = _p.tail = _p.cons_cache = 0;
+	_c.head = _c.tail_cache = 0;
+    }
+    ~MPSCRing()				{ delete[] _ring; }
+
+    int initialize(uint32_t capacity);
+
+    uint32_t capacity() const		{ return _mask + 1; }
+    inline uint32_t size() const;
+    inline bool empty() const		{ return size() == 0; }
+
+    inline uint32_t enqueue_burst(const T *v, uint32_t n);
+    inline uint32_t dequeue_burst(T *v, uint32_t n);
+    inline bool enqueue(const T &x)	{ return enqueue_burst(&x, 1); }
+    inline bool dequeue(T &x)		{ return dequeue_burst(&x, 1); }
+
+  private:
+
+    struct {
+	uint32_t head;		// next slot to reserve
+	uint32_t tail;		// slots before this are published
+	uint32_t cons_cache;	// some past value of _c.head
+    } _p LFRING_ALIGN;
+    struct {
+	uint32_t head;
+	uint32_t tail_cache;
+    } _c LFRING_ALIGN;
+    T *_ring LFRING_ALIGN;
+    uint32_t _mask;
+
+    MPSCRing(const MPSCRing<T> &);
+    MPSCRing<T> &operator=(const MPSCRing<T> &);
+
+};
+
+template <typename T>
+static inline int
+lfring_alloc(T *&ring, uint32_t &mask, uint32_t capacity)
+{
+    uint32_t n = 1;
+    while (n < capacity)
+	n <<= 1;
+    if (!(ring = new T[n]))
+	return -ENOMEM;
+    mask = n - 1;
+    return 0;
+}
+
+template <typename T>
+int
+SPSCRing<T>::initialize(uint32_t capacity)
+{
+    return lfring_alloc(_ring, _mask, capacity);
+}
+
+template <typename T>
+inline uint32_t
+SPSCRing<T>::size() const
+{
+    return __atomic_load_n(&_p.tail, __ATOMIC_ACQUIRE)
+	- __atomic_load_n(&_c.head, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+inline uint32_t
+SPSCRing<T>::enqueue_burst(const T *v, uint32_t n)
+{
+    uint32_t tail = _p.tail;
+    uint32_t room = _mask + 1 - (tail - _p.head_cache);
+
+    if (room < n) {
+	_p.head_cache = __atomic_load_n(&_c.head, __ATOMIC_ACQUIRE);
+	room = _mask + 1 - (tail - _p.head_cache);
+	if (room < n)
+	    n = room;
+    }
+    for (uint32_t i = 0; i < n; ++i)
+	_ring[(tail + i) & _mask] = v[i];
+    if (n)
+	__atomic_store_n(&_p.tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+template <typename T>
+inline uint32_t
+SPSCRing<T>::dequeue_burst(T *v, uint32_t n)
+{
+    uint32_t head = _c.head;
+    uint32_t avail = _c.tail_cache - head;
+
+    if (avail < n) {
+	_c.tail_cache = __atomic_load_n(&_p.tail, __ATOMIC_ACQUIRE);
+	avail = _c.tail_cache - head;
+	if (avail < n)
+	    n = avail;
+    }
+    for (uint32_t i = 0; i < n; ++i)
+	v[i] = _ring[(head + i) & _mask];
+    if (n)
+	__atomic_store_n(&_c.head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+template <typename T>
+int
+MPSCRing<T>::initialize(uint32_t capacity)
+{
+    return lfring_alloc(_ring, _mask, capacity);
+}
+
+template <typename T>
+inline uint32_t
+MPSCRing<T>::size() const
+{
+    return __atomic_load_n(&_p.tail, __ATOMIC_ACQUIRE)
+	- __atomic_load_n(&_c.head, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+inline uint32_t
+MPSCRing<T>::enqueue_burst(const T *v, uint32_t n)
+{
+    uint32_t head = __atomic_load_n(&_p.head, __ATOMIC_RELAXED);
+    uint32_t cons, room;
+
+    do {
+	/* The shared copy may go back in time when producers refresh it
+	 * concurrently, so it can even be more than a ring behind. */
+	cons = __atomic_load_n(&_p.cons_cache, __ATOMIC_RELAXED);
+	room = head - cons <= _mask + 1 ? _mask + 1 - (head - cons) : 0;
+	if (room < n) {
+	    cons = __atomic_load_n(&_c.head, __ATOMIC_ACQUIRE);
+	    __atomic_store_n(&_p.cons_cache, cons, __ATOMIC_RELAXED);
+	    room = _mask + 1 - (head - cons);
+	}
+	if (room < n)
+	    n = room;
+	if (!n)
+	    return 0;
+    } while (!__atomic_compare_exchange_n(&_p.head, &head, head + n, true,
+					  __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    for (uint32_t i = 0; i < n; ++i)
+	_ring[(head + i) & _mask] = v[i];
+
+    /* Publish after the producers that reserved before us. */
+    while (__atomic_load_n(&_p.tail, __ATOMIC_RELAXED) != head)
+	click_relax_fence();
+    __atomic_store_n(&_p.tail, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+template <typename T>
+inline uint32_t
+MPSCRing<T>::dequeue_burst(T *v, uint32_t n)
+{
+    uint32_t head = _c.head;
+    uint32_t avail = _c.tail_cache - head;
+
+    if (avail < n) {
+	_c.tail_cache = __atomic_load_n(&_p.tail, __ATOMIC_ACQUIRE);
+	avail = _c.tail_cache - head;
+	if (avail < n)
+	    n = avail;
+    }
+    for (uint32_t i = 0; i < n; ++i)
+	v[i] = _ring[(head + i) & _mask];
+    if (n)
+	__atomic_store_n(&_c.head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,350 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "netdevice.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click_alloc.h>
+#include <click_netdev.h>
+
+#include <uk/alloc.h>
+#include <uk/netdev.h>
+#include <uk/sched.h>
+
+CLICK_DECLS
+
+NetDev::NetDev(int devid_, struct uk_netdev *dev_)
+	: devid(devid_), dev(dev_), owner(0), nrxq(1),
+	  rx_ring(CONFIG_LIBCLICK_RX_RING), tx_ring(CONFIG_LIBCLICK_TX_RING),
+	  mtu(0), bufsize(CONFIG_LIBCLICK_RX_BUFSIZE), recycle((uint32_t) -1),
+	  intr(true), started(false)
+{
+	uk_netdev_info_get(dev, &info);
+	ntxq = click_netdev_tx_queues(&info);
+#ifdef UK_NETDEV_F_TSO4
+	tso = info.features & UK_NETDEV_F_TSO4;
+#else
+	tso = false;
+#endif
+}
+
+/* Devices are created on first use and kept for good */
+NetDev *
+NetDev::get(int devid, ErrorHandler *errh)
+{
+	static Vector<NetDev *> devs;
+	struct uk_netdev *dev;
+	int state;
+
+	if (devid < 0) {
+		errh->error("Device ID must be >= 0");
+		return 0;
+	}
+	if (devid < devs.size() && devs[devid])
+		return devs[devid];
+
+	dev = uk_netdev_get((unsigned int) devid);
+	if (!dev) {
+		errh->error("No such device %d", devid);
+		return 0;
+	}
+	/* e.g. the control socket's device, configured by lwIP */
+	state = uk_netdev_state_get(dev);
+	if (state != UK_NETDEV_UNCONFIGURED) {
+		errh->error("Device %d is in use elsewhere (state %d)", devid, state);
+		return 0;
+	}
+	if (devid >= devs.size())
+		devs.resize(devid + 1, 0);
+	devs[devid] = new NetDev(devid, dev);
+	if (!devs[devid])
+		errh->error("out of memory");
+	return devs[devid];
+}
+
+int
+NetDev::check(ErrorHandler *errh)
+{
+	if (nrxq < 1 || (info.max_rx_queues && nrxq > info.max_rx_queues))
+		return errh->error("RX_QUEUES must be between 1 and %u for device %d",
+				   info.max_rx_queues, devid);
+	if (ntxq < 1 || (info.max_tx_queues && ntxq > info.max_tx_queues))
+		return errh->error("TX_QUEUES must be between 1 and %u for device %d",
+				   info.max_tx_queues, devid);
+	if (rx_ring < 1 || tx_ring < 1)
+		return errh->error("RX_RING and TX_RING must be > 0");
+	if (bufsize < 64 || bufsize > 65535)
+		return errh->error("BUFSIZE must be between 64 and 65535");
+	if (recycle != (uint32_t) -1 && recycle > (1U << 20))
+		return errh->error("RECYCLE must be at most 2^20");
+	if (mtu && info.max_mtu && mtu > info.max_mtu)
+		return errh->error("MTU %u exceeds the maximum of device %d (%u)",
+				   mtu, devid, info.max_mtu);
+	if (mtu + 18U > bufsize)
+		errh->warning("MTU %u does not fit into BUFSIZE %u, device %d must chain receive buffers",
+			      mtu, bufsize, devid);
+	return 0;
+}
+
+/* Every queue gets its own pool since only its receive thread takes from
+ * it; any thread may give back.
+ */
+void
+NetDev::rx_release(struct uk_netbuf *buf)
+{
+	struct uk_netbuf *next;
+	RxPool *pool;
+
+	for (; buf; buf = next) {
+		next = buf->next;
+		pool = *static_cast<RxPool **>(buf->priv);
+		buf->next = buf->prev = NULL;
+		if (pool && pool->ring.enqueue(buf))
+			continue;
+		uk_netbuf_free(buf);
+	}
+}
+
+uint16_t
+NetDev::alloc_rxpkts(void *argp, struct uk_netbuf *pkts[], uint16_t count)
+{
+	RxQueue *q = static_cast<RxQueue *>(argp);
+	NetDev *nd = q->nd;
+	uint16_t headroom = RX_HEADROOM + nd->info.nb_encap_rx;
+	uint16_t i = 0;
+
+	if (q->pool) {
+		i = q->pool->ring.dequeue_burst(pkts, count);
+		for (uint16_t j = 0; j < i; ++j) {
+			pkts[j]->data = (char *) pkts[j]->buf + headroom;
+			pkts[j]->flags = 0;
+		}
+	}
+	for (; i < count; ++i) {
+		pkts[i] = uk_netbuf_alloc_buf(uk_alloc_get_default(),
+				nd->bufsize + headroom, nd->info.ioalign,
+				headroom, sizeof(RxPool *), CLICK_MEM_NETBUF_DTOR);
+		if (!pkts[i])
+			break;
+		click_mem_netbuf_alloc(pkts[i]);
+		*static_cast<RxPool **>(pkts[i]->priv) = q->pool;
+	}
+	for (uint16_t j = 0; j < i; ++j)
+		pkts[j]->len = nd->bufsize;
+	return i;
+}
+
+void
+NetDev::rx_callback(struct uk_netdev *, uint16_t queue_id, void *cookie)
+{
+	RxQueue *q = static_cast<RxQueue *>(cookie);
+
+	uk_pr_debug("netdev %d queue %u callback\n", q->nd->devid, queue_id);
+	if (q->intr)
+		q->intr(q->arg);
+}
+
+int
+NetDev::attach_rx(uint16_t queue, void (*fn)(void *), void *arg,
+		  ErrorHandler *errh)
+{
+	if (queue >= nrxq)
+		return errh->error("Device %d has no RX queue %u", devid, queue);
+	if (!started)
+		_rxq.resize(nrxq, RxQueue());
+	if (_rxq[queue].intr)
+		return errh->error("RX queue %u of device %d is taken", queue, devid);
+	_rxq[queue].intr = fn;
+	_rxq[queue].arg = arg;
+	return 0;
+}
+
+void
+NetDev::detach_rx(uint16_t queue, void *arg)
+{
+	if (queue < _rxq.size() && _rxq[queue].arg == arg) {
+		_rxq[queue].intr = 0;
+		_rxq[queue].arg = 0;
+	}
+}
+
+/* TX queues have no lock, so every element sending on one must do so from
+ * the same thread. Elements on one thread take turns and can share it.
+ */
+int
+NetDev::attach_tx(uint16_t queue, int thread, ErrorHandler *errh)
+{
+	if (queue >= ntxq)
+		return errh->error("Device %d has no TX queue %u", devid, queue);
+	if (_txq.size() < ntxq)
+		_txq.resize(ntxq, TxQueue());
+	if (_txq[queue].users && _txq[queue].thread != thread)
+		return errh->error("TX queue %u of device %d is used by thread %d",
+				   queue, devid, _txq[queue].thread);
+	_txq[queue].thread = thread;
+	_txq[queue].users++;
+	return 0;
+}
+
+void
+NetDev::detach_tx(uint16_t queue)
+{
+	if (queue < _txq.size() && _txq[queue].users)
+		_txq[queue].users--;
+}
+
+/* Configures and starts the device the first time; later calls, from
+ * other elements or routers, find it running.
+ */
+int
+NetDev::start(ErrorHandler *errh)
+{
+	struct uk_netdev_conf conf;
+	struct uk_netdev_rxqueue_conf rx_conf;
+	struct uk_netdev_txqueue_conf tx_conf;
+	uint32_t npool = recycle == (uint32_t) -1 ? 2 * rx_ring : recycle;
+	int rc;
+
+	if (started)
+		return 0;
+
+	conf.nb_rx_queues = nrxq;
+	conf.nb_tx_queues = ntxq;
+	uk_pr_info("netdev %d: %u RX queue(s), %u TX queue(s)\n",
+		   devid, nrxq, ntxq);
+	if (uk_netdev_configure(dev, &conf) < 0)
+		return errh->error("Failed to configure device %d", devid);
+	if (mtu && (rc = uk_netdev_mtu_set(dev, mtu)) < 0)
+		return errh->error("Failed to set MTU %u on device %d: %d", mtu, devid, rc);
+
+	_rxq.resize(nrxq, RxQueue());
+	for (uint16_t q = 0; q < nrxq; ++q) {
+		RxQueue &rxq = _rxq[q];
+
+		rxq.nd = this;
+		rxq.id = q;
+		if (npool) {
+			rxq.pool = new RxPool;
+			if (!rxq.pool || rxq.pool->ring.initialize(npool) < 0)
+				return errh->error("out of memory");
+		}
+		rx_conf.s = uk_sched_current();
+		rx_conf.a = uk_alloc_get_default();
+		rx_conf.callback = rx_callback;
+		rx_conf.callback_cookie = &rxq;
+		rx_conf.alloc_rxpkts = alloc_rxpkts;
+		rx_conf.alloc_rxpkts_argp = &rxq;
+		if (uk_netdev_rxq_configure(dev, q, rx_ring, &rx_conf))
+			return errh->error("Failed to set up RX queue %u (%u descriptors) for device %d",
+					   q, rx_ring, devid);
+	}
+	tx_conf.a = uk_alloc_get_default();
+	for (uint16_t q = 0; q < ntxq; ++q)
+		if (uk_netdev_txq_configure(dev, q, tx_ring, &tx_conf))
+			return errh->error("Failed to set up TX queue %u (%u descriptors) for device %d",
+					   q, tx_ring, devid);
+	if (uk_netdev_start(dev))
+		return errh->error("Failed to start device %d", devid);
+	started = true;
+	return 0;
+}
+
+NetDevice::NetDevice()
+	: _nd(0)
+{
+}
+
+NetDevice::~NetDevice()
+{
+}
+
+int
+NetDevice::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	int devid = 0;
+
+	if (Args(this, errh).bind(conf)
+			.read_p("DEVID", IntArg(), devid)
+			.consume() < 0)
+		return -1;
+	if (!(_nd = NetDev::get(devid, errh)))
+		return -1;
+	if (_nd->owner)
+		return errh->error("Device %d is configured by %s already",
+				   devid, _nd->owner->declaration().c_str());
+
+	/* settings only stick if they are valid and the device is not
+	 * running yet, as set up by an earlier router
+	 */
+	NetDev nd(*_nd);
+
+	if (Args(conf, this, errh)
+			.read("RX_QUEUES", nd.nrxq)
+			.read("TX_QUEUES", nd.ntxq)
+			.read("RX_RING", nd.rx_ring)
+			.read("TX_RING", nd.tx_ring)
+			.read("MTU", nd.mtu)
+			.read("BUFSIZE", nd.bufsize)
+			.read("RECYCLE", nd.recycle)
+			.read("INTERRUPT", nd.intr)
+			.read("TSO", nd.tso)
+			.complete() < 0
+	    || nd.check(errh) < 0)
+		return -1;
+#ifdef UK_NETDEV_F_TSO4
+	nd.tso = nd.tso && (nd.info.features & UK_NETDEV_F_TSO4);
+#else
+	nd.tso = false;
+#endif
+	if (_nd->started)
+		errh->warning("Device %d is running already, its settings stay as they are", devid);
+	else
+		*_nd = nd;
+	_nd->owner = this;
+	return 0;
+}
+
+int
+NetDevice::initialize(ErrorHandler *errh)
+{
+	return _nd->start(errh);
+}
+
+void
+NetDevice::cleanup(CleanupStage)
+{
+	if (_nd && _nd->owner == this)
+		_nd->owner = 0;
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(NetDevice)
@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_NETDEVICE_HH
+#define CLICK_NETDEVICE_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/error.hh>
+#include <click/vector.hh>
+#include "lfring.hh"
+
+#include <uk/netdev.h>
+
+CLICK_DECLS
+
+extern "C" {
+    struct uk_netdev;
+}
+
+/*
+=c
+
+NetDevice(DEVID [, I<keywords> RX_QUEUES, TX_QUEUES, RX_RING, TX_RING, MTU, BUFSIZE, RECYCLE, INTERRUPT, TSO])
+
+=s netdevices
+
+configures a Unikraft network device
+
+=d
+
+Sets up and starts network device DEVID for the FromDevice, ToDevice and
+DeviceGenerator elements using it, which attach to its queues. The
+device's queues, rings, buffers and offloads are configured here, once,
+whether the configuration receives, sends or both.
+
+Without a NetDevice element, a device is set up with the defaults below
+by the first of its elements to be initialized, and the ring and buffer
+keywords of FromDevice apply.
+
+Keyword arguments are:
+
+=over 8
+
+=item RX_QUEUES
+
+Integer. Number of receive queues; FromDevice's QUEUE picks one. Default
+is 1.
+
+=item TX_QUEUES
+
+Integer. Number of transmit queues, which ToDevice maps the router threads
+onto. Default is one per router thread, as far as the device has them.
+
+=item RX_RING
+
+Integer. Number of receive descriptors per queue. Default is 256, or
+LIBCLICK_RX_RING if set differently.
+
+=item TX_RING
+
+Integer. Number of transmit descriptors per queue. Default is 256, or
+LIBCLICK_TX_RING.
+
+=item MTU
+
+Integer. MTU to configure on the device. Default is to leave it alone.
+
+=item BUFSIZE
+
+Integer. Size of each receive buffer. Default is 2048, or
+LIBCLICK_RX_BUFSIZE; frames larger than this need a device that can chain
+receive buffers.
+
+=item RECYCLE
+
+Integer. Number of receive buffers per queue kept for reuse once the
+packets built on them are freed, on whatever thread that happens. The
+device is refilled from these before new buffers are allocated, so in
+steady state receiving allocates nothing. 0 disables reuse. Default is
+twice RX_RING.
+
+=item INTERRUPT
+
+Boolean. Wake FromDevice by receive interrupts. If false, FromDevice polls
+its queue from its task instead, which costs a CPU but saves the
+interrupt latency. Default is true.
+
+=item TSO
+
+Boolean. Leave TCP over IPv4 segmentation to the device if it supports
+TCP segmentation offload (see ToDevice). Default is true.
+
+=back
+
+=e
+
+  NetDevice(0, RX_QUEUES 2, RX_RING 1024, INTERRUPT false);
+  FromDevice(0, QUEUE 0) -> ... -> ToDevice(0);
+  FromDevice(0, QUEUE 1) -> ... -> ToDevice(0);
+
+=a FromDevice, ToDevice, DeviceGenerator
+*/
+
+/* The state of one network device, shared by the elements using it. It
+ * outlives routers: a started device cannot be set up again, so a new
+ * router attaches to it as it is.
+ */
+class NetDev {
+public:
+    enum { RX_HEADROOM = 64 };	/* room to prepend headers to received frames */
+
+    /* Received buffers waiting to be handed to the device again */
+    struct RxPool {
+	MPSCRing<struct uk_netbuf *> ring;
+    };
+
+    struct RxQueue {
+	NetDev *nd;
+	uint16_t id;
+	RxPool *pool;
+	void (*intr)(void *);	/* of the attached FromDevice, if any */
+	void *arg;
+    };
+
+    static NetDev *get(int devid, ErrorHandler *);
+    int check(ErrorHandler *);
+    int start(ErrorHandler *);
+    int attach_rx(uint16_t queue, void (*intr)(void *), void *arg, ErrorHandler *);
+    void detach_rx(uint16_t queue, void *arg);
+    int attach_tx(uint16_t queue, int thread, ErrorHandler *);
+    void detach_tx(uint16_t queue);
+
+    /* Gives a received buffer (chain) back once Click is done with it */
+    static void rx_release(struct uk_netbuf *);
+
+    int devid;
+    struct uk_netdev *dev;
+    struct uk_netdev_info info;
+    Element *owner;		/* NetDevice element configuring it, if any */
+    uint16_t nrxq;
+    uint16_t ntxq;
+    uint16_t rx_ring;
+    uint16_t tx_ring;
+    uint16_t mtu;
+    uint32_t bufsize;
+    uint32_t recycle;
+    bool intr;
+    bool tso;
+    bool started;
+
+private:
+    NetDev(int devid, struct uk_netdev *);
+
+    static uint16_t alloc_rxpkts(void *argp, struct uk_netbuf *pkts[], uint16_t count);
+    static void rx_callback(struct uk_netdev *, uint16_t, void *);
+
+    /* Elements sending on a TX queue, all from one thread */
+    struct TxQueue {
+	int thread;
+	int users;
+    };
+
+    Vector<RxQueue> _rxq;
+    Vector<TxQueue> _txq;
+};
+
+class NetDevice : public Element {
+public:
+    NetDevice();
+    ~NetDevice();
+
+    const char *class_name() const { return "NetDevice"; }
+    const char *port_count() const { return PORTS_0_0; }
+    int configure_phase() const { return CONFIGURE_PHASE_FIRST; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+
+private:
+    NetDev *_nd;
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,1026 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "poptrieip6lookup.hh"
+
+#include <click/args.hh>
+#include <click/atomic.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+#include <click/cycles.hh>
+#include <click/ip6table.hh>
+#endif
+
+#include <click_alloc.h>
+#include <click_tables.h>
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+#include <uk/print.h>
+#endif
+
+CLICK_DECLS
+
+static inline int
+addr_bit(const unsigned char *d, int i)
+{
+	return (d[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+static inline uint64_t
+load_be64(const unsigned char *d)
+{
+	uint64_t v = 0;
+
+	for (int i = 0; i < 8; ++i)
+		v = (v << 8) | d[i];
+	return v;
+}
+
+/* STRIDE bits of the address starting at bit off (< 128) */
+static inline uint32_t
+extract_bits(uint64_t hi, uint64_t lo, int off, int stride)
+{
+	unsigned __int128 a = ((unsigned __int128) hi << 64) | lo;
+
+	return (uint32_t) ((a << off) >> (128 - stride));
+}
+
+static inline bool
+addr_is_zero(const IP6Address &a)
+{
+	const unsigned char *d = a.data();
+
+	for (int i = 0; i < 16; ++i)
+		if (d[i])
+			return false;
+	return true;
+}
+
+static inline void
+mask_addr(IP6Address &a, int prefix_len)
+{
+	unsigned char *d = a.data();
+
+	for (int i = 0; i < 16; ++i) {
+		int bits = prefix_len - i * 8;
+
+		if (bits <= 0)
+			d[i] = 0;
+		else if (bits < 8)
+			d[i] &= 0xFF << (8 - bits);
+	}
+}
+
+PoptrieIP6Lookup::PoptrieIP6Lookup()
+	: _t(0), _old_t(0), _vfree(-1), _btfree(-1)
+{
+	BNode root = { { -1, -1 }, -1 };
+
+	_bt.push_back(root);
+}
+
+PoptrieIP6Lookup::~PoptrieIP6Lookup()
+{
+}
+
+String
+PoptrieIP6Lookup::prefix_key(const IP6Address &a, int prefix_len)
+{
+	String key((const char *) a.data(), 16);
+
+	key += (char) prefix_len;
+	return key;
+}
+
+bool
+PoptrieIP6Lookup::parse_route(const String &s, Route &r, bool remove,
+		Element *e, ErrorHandler *errh)
+{
+	Vector<String> words;
+
+	cp_spacevec(s, words);
+	r.gw = IP6Address();
+	r.port = -1;
+	if (words.size() < (remove ? 1 : 2) || words.size() > 3
+	    || !IP6PrefixArg(true).parse(words[0], r.addr, r.prefix_len, e)
+	    || (words.size() == 3
+		&& !IP6AddressArg().parse(words[1], r.gw, e))
+	    || (words.size() >= 2 && !IntArg().parse(words.back(), r.port))) {
+		errh->error("expected ADDR/PREFIXLEN [GW] %s, got %<%s%>",
+			    remove ? "[OUT]" : "OUT", s.c_str());
+		return false;
+	}
+	mask_addr(r.addr, r.prefix_len);
+	return true;
+}
+
+int
+PoptrieIP6Lookup::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	int before = errh->nerrors();
+	String table, data;
+
+	if (Args(conf, this, errh)
+			.read("TABLE", AnyArg(), table)
+			.consume() < 0)
+		return -1;
+	if (table) {
+		if (!click_initrd_member(table, data))
+			return errh->error("no table %<%s%> in the initrd",
+					   table.c_str());
+		if (load_table(data, errh) < 0)
+			return -1;
+	}
+
+	for (int i = 0; i < conf.size(); ++i) {
+		Route r;
+
+		if (parse_route(conf[i], r, false, this, errh)
+		    && add_route(r, false, errh) == -EEXIST)
+			errh->error("route %<%s%> already exists",
+				    conf[i].c_str());
+	}
+	if (errh->nerrors() != before)
+		return -1;
+	if (rebuild(_v) < 0)
+		return errh->error("out of memory");
+	return 0;
+}
+
+void
+PoptrieIP6Lookup::cleanup(CleanupStage)
+{
+	free_trie(_t);
+	free_trie(_old_t);
+	_t = _old_t = 0;
+}
+
+int
+PoptrieIP6Lookup::bt_alloc()
+{
+	BNode n = { { -1, -1 }, -1 };
+	int i;
+
+	if (_btfree >= 0) {
+		i = _btfree;
+		_btfree = _bt[i].child[0];
+		_bt[i] = n;
+		return i;
+	}
+	ClickMemScope mem(CLICK_MEM_TABLES);
+	_bt.push_back(n);
+	return _bt.size() - 1;
+}
+
+void
+PoptrieIP6Lookup::bt_insert(const IP6Address &a, int prefix_len, int route)
+{
+	int n = 0, c, b;
+
+	for (int i = 0; i < prefix_len; ++i) {
+		b = addr_bit(a.data(), i);
+		if ((c = _bt[n].child[b]) < 0) {
+			c = bt_alloc();
+			_bt[n].child[b] = c;
+		}
+		n = c;
+	}
+	_bt[n].route = route;
+}
+
+bool
+PoptrieIP6Lookup::bt_remove(int n, const IP6Address &a, int depth,
+		int prefix_len)
+{
+	if (depth == prefix_len)
+		_bt[n].route = -1;
+	else {
+		int b = addr_bit(a.data(), depth);
+		int c = _bt[n].child[b];
+
+		if (c >= 0 && bt_remove(c, a, depth + 1, prefix_len)) {
+			_bt[c].child[0] = _btfree;
+			_btfree = c;
+			_bt[n].child[b] = -1;
+		}
+	}
+	return n != 0 && _bt[n].route < 0 && !bt_internal(n);
+}
+
+int
+PoptrieIP6Lookup::bt_walk(int n, uint32_t bits, int len, int &best) const
+{
+	for (int k = len - 1; k >= 0 && n >= 0; --k) {
+		n = _bt[n].child[(bits >> k) & 1];
+		if (n >= 0 && _bt[n].route >= 0)
+			best = _bt[n].route;
+	}
+	return n;
+}
+
+PoptrieIP6Lookup::Trie *
+PoptrieIP6Lookup::alloc_trie(uint32_t cap_nodes, uint32_t cap_leaves)
+{
+	ClickMemScope mem(CLICK_MEM_TABLES);
+	Trie *t = new Trie;
+
+	if (!t)
+		return 0;
+	t->dp = new uint32_t[DP_SIZE];
+	t->dp_used = new uint32_t[DP_SIZE];
+	t->nodes = new Node[cap_nodes];
+	t->leaves = new uint32_t[cap_leaves];
+	if (!t->dp || !t->dp_used || !t->nodes || !t->leaves) {
+		free_trie(t);
+		return 0;
+	}
+	memset(t->dp, 0, sizeof(uint32_t) * DP_SIZE);
+	memset(t->dp_used, 0, sizeof(uint32_t) * DP_SIZE);
+	t->routes = 0;
+	t->nnodes = t->nleaves = t->garbage = 0;
+	t->cap_nodes = cap_nodes;
+	t->cap_leaves = cap_leaves;
+	return t;
+}
+
+void
+PoptrieIP6Lookup::free_trie(Trie *t)
+{
+	if (!t)
+		return;
+	delete[] t->dp;
+	delete[] t->dp_used;
+	delete[] t->nodes;
+	delete[] t->leaves;
+	delete t;
+}
+
+void
+PoptrieIP6Lookup::swap_trie(Trie *t)
+{
+	/* The previous trie may still be in use by a lookup on another
+	 * thread, it goes away on the next swap.
+	 */
+	click_fence();
+	free_trie(_old_t);
+	_old_t = _t;
+	_t = t;
+}
+
+bool
+PoptrieIP6Lookup::build_node(Trie *t, int bn, int off, int inherited,
+		uint32_t idx)
+{
+	int child[64], child_best[64];
+	uint64_t vector = 0, leafvec = 0;
+	uint32_t base0 = t->nleaves, base1, last = 0;
+	int nc = 0, best, c;
+
+	if (t->nleaves + 64 > t->cap_leaves)
+		return false;
+	for (uint32_t v = 0; v < 64; ++v) {
+		best = inherited;
+		c = bt_walk(bn, v, STRIDE, best);
+		if (c >= 0 && bt_internal(c)) {
+			vector |= 1ULL << v;
+			child[nc] = c;
+			child_best[nc++] = best;
+		} else if (t->nleaves == base0 || (uint32_t) (best + 1) != last) {
+			leafvec |= 1ULL << v;
+			last = best + 1;
+			t->leaves[t->nleaves++] = last;
+		}
+	}
+
+	if (t->nnodes + nc > t->cap_nodes)
+		return false;
+	base1 = t->nnodes;
+	t->nnodes += nc;
+	for (int k = 0; k < nc; ++k)
+		if (!build_node(t, child[k], off + STRIDE, child_best[k],
+				base1 + k))
+			return false;
+
+	t->nodes[idx].vector = vector;
+	t->nodes[idx].leafvec = leafvec;
+	t->nodes[idx].base0 = base0;
+	t->nodes[idx].base1 = base1;
+	return true;
+}
+
+bool
+PoptrieIP6Lookup::build_dp(Trie *t, uint32_t i)
+{
+	uint32_t used = t->nnodes + t->nleaves, idx, e;
+	int best = _bt[0].route;
+	int c = bt_walk(0, i, DP_BITS, best);
+
+	if (c >= 0 && bt_internal(c)) {
+		if (t->nnodes == t->cap_nodes)
+			return false;
+		idx = t->nnodes++;
+		if (!build_node(t, c, DP_BITS, best, idx))
+			return false;
+		e = DP_NODE | idx;
+	} else
+		e = best + 1;
+
+	/* Everything below the entry is in place, switch it over */
+	t->garbage += t->dp_used[i];
+	t->dp_used[i] = t->nnodes + t->nleaves - used;
+	click_fence();
+	t->dp[i] = e;
+	return true;
+}
+
+/* Builds a trie for the routes in v and swaps it in */
+int
+PoptrieIP6Lookup::rebuild(const Vector<Route> &v)
+{
+	uint32_t cap_nodes = 1024, cap_leaves = 4096;
+	Trie *t;
+
+	if (_t) {
+		cap_nodes = _t->nnodes * 2 > cap_nodes ? _t->nnodes * 2
+			: cap_nodes;
+		cap_leaves = _t->nleaves * 2 > cap_leaves ? _t->nleaves * 2
+			: cap_leaves;
+	}
+	for (;;) {
+		if (!(t = alloc_trie(cap_nodes, cap_leaves)))
+			return -ENOMEM;
+		uint32_t i;
+		for (i = 0; i < DP_SIZE; ++i) {
+			if (!build_dp(t, i))
+				break;
+			click_table_yield(i);
+		}
+		if (i == DP_SIZE)
+			break;
+		free_trie(t);
+		cap_nodes *= 2;
+		cap_leaves *= 2;
+	}
+	t->garbage = 0;
+	t->routes = v.begin();
+	swap_trie(t);
+	return 0;
+}
+
+/* Lookups index the route array without a lock, so it never grows in
+ * place. Like load_table, this copies the routes into a larger array and
+ * swaps it in together with a trie built for it; the old array stays with
+ * the old trie.
+ */
+int
+PoptrieIP6Lookup::grow_routes()
+{
+	Vector<Route> v;
+	int cap = _v.size() * 2 > ROUTES_MIN ? _v.size() * 2 : ROUTES_MIN;
+
+	if (!v.reserve(cap))
+		return -ENOMEM;
+	for (int i = 0; i < _v.size(); ++i)
+		v.push_back(_v[i]);
+	if (_t && rebuild(v) < 0)
+		return -ENOMEM;
+	_old_v.swap(_v);
+	_v.swap(v);
+	return 0;
+}
+
+int
+PoptrieIP6Lookup::update(const IP6Address &a, int prefix_len)
+{
+	const unsigned char *d = a.data();
+	uint32_t first = (d[0] << 8) | d[1], n = 1;
+
+	if (!_t)
+		return 0;
+	if (prefix_len < DP_BITS) {
+		n = 1U << (DP_BITS - prefix_len);
+		first &= ~(n - 1);
+	}
+	for (uint32_t i = first; i < first + n; ++i)
+		if (!build_dp(_t, i))
+			return rebuild(_v);
+	if (_t->garbage > (_t->nnodes + _t->nleaves) / 2)
+		return rebuild(_v);
+	return 0;
+}
+
+int
+PoptrieIP6Lookup::add_route(const Route &route, bool allow_replace,
+		ErrorHandler *errh)
+{
+	String key = prefix_key(route.addr, route.prefix_len);
+	int idx, old_idx = -1;
+
+	if (route.port < 0 || route.port >= noutputs())
+		return errh->error("output %d out of range", route.port);
+	HashTable<String, int>::iterator it = _prefixes.find(key);
+	if (it != _prefixes.end()) {
+		if (!allow_replace)
+			return -EEXIST;
+		old_idx = it.value();
+	}
+
+	if (_vfree >= 0) {
+		idx = _vfree;
+		_vfree = _v[idx].extra;
+	} else {
+		if (_v.size() == _v.capacity() && grow_routes() < 0)
+			return -ENOMEM;
+		idx = _v.size();
+		_v.push_back(route);
+	}
+	_v[idx] = route;
+	_prefixes.set(key, idx);
+	bt_insert(route.addr, route.prefix_len, idx);
+	if (old_idx >= 0) {
+		_v[old_idx].extra = _vfree;
+		_vfree = old_idx;
+	}
+	return update(route.addr, route.prefix_len);
+}
+
+int
+PoptrieIP6Lookup::remove_route(const Route &route, ErrorHandler *)
+{
+	String key = prefix_key(route.addr, route.prefix_len);
+	int idx;
+
+	HashTable<String, int>::iterator it = _prefixes.find(key);
+	if (it == _prefixes.end())
+		return -ENOENT;
+	idx = it.value();
+	if (route.port >= 0
+	    && (route.port != _v[idx].port || route.gw != _v[idx].gw))
+		return -ENOENT;
+
+	_prefixes.erase(key);
+	bt_remove(0, route.addr, 0, route.prefix_len);
+	_v[idx].port = -1;
+	_v[idx].extra = _vfree;
+	_vfree = idx;
+	return update(route.addr, route.prefix_len);
+}
+
+int
+PoptrieIP6Lookup::lookup_route(const IP6Address &a, IP6Address &gw) const
+{
+	const Trie *t = _t;
+	const unsigned char *d = a.data();
+	uint64_t hi = load_be64(d), lo = load_be64(d + 8);
+	uint32_t e = t->dp[hi >> (64 - DP_BITS)];
+	int off = DP_BITS;
+
+	while (e & DP_NODE) {
+		const Node &n = t->nodes[e & ~DP_NODE];
+		uint32_t v = extract_bits(hi, lo, off, STRIDE);
+		uint64_t m = (2ULL << v) - 1;
+
+		if (n.vector & (1ULL << v)) {
+			e = DP_NODE | (n.base1 + __builtin_popcountll(n.vector & m) - 1);
+			off += STRIDE;
+		} else
+			e = t->leaves[n.base0 + __builtin_popcountll(n.leafvec & m) - 1];
+	}
+	if (!e)
+		return -1;
+	gw = t->routes[e - 1].gw;
+	return t->routes[e - 1].port;
+}
+
+void
+PoptrieIP6Lookup::lookup_batch(const IP6Address *addrs, int *ports,
+		IP6Address *gws, int n) const
+{
+	const Trie *t = _t;
+	uint64_t hi[BATCH_MAX], lo[BATCH_MAX];
+	uint32_t e[BATCH_MAX];
+	int off[BATCH_MAX];
+	int i, base, m, active;
+
+	for (base = 0; base < n; base += m) {
+		m = n - base < BATCH_MAX ? n - base : BATCH_MAX;
+		for (i = 0; i < m; ++i) {
+			hi[i] = load_be64(addrs[base + i].data());
+			lo[i] = load_be64(addrs[base + i].data() + 8);
+			off[i] = DP_BITS;
+			__builtin_prefetch(&t->dp[hi[i] >> (64 - DP_BITS)]);
+		}
+		for (i = 0; i < m; ++i) {
+			e[i] = t->dp[hi[i] >> (64 - DP_BITS)];
+			if (e[i] & DP_NODE)
+				__builtin_prefetch(&t->nodes[e[i] & ~DP_NODE]);
+		}
+
+		/* Walk all tries one level at a time, so the next level of one
+		 * address loads while the others are being resolved
+		 */
+		do {
+			active = 0;
+			for (i = 0; i < m; ++i) {
+				if (!(e[i] & DP_NODE))
+					continue;
+				const Node &nd = t->nodes[e[i] & ~DP_NODE];
+				uint32_t v = extract_bits(hi[i], lo[i], off[i],
+							  STRIDE);
+				uint64_t mk = (2ULL << v) - 1;
+
+				if (nd.vector & (1ULL << v)) {
+					e[i] = DP_NODE | (nd.base1
+						+ __builtin_popcountll(nd.vector & mk) - 1);
+					off[i] += STRIDE;
+					__builtin_prefetch(&t->nodes[e[i] & ~DP_NODE]);
+					++active;
+				} else
+					e[i] = t->leaves[nd.base0
+						+ __builtin_popcountll(nd.leafvec & mk) - 1];
+			}
+		} while (active);
+
+		for (i = 0; i < m; ++i) {
+			if (!e[i]) {
+				ports[base + i] = -1;
+				continue;
+			}
+			gws[base + i] = t->routes[e[i] - 1].gw;
+			ports[base + i] = t->routes[e[i] - 1].port;
+		}
+	}
+}
+
+void
+PoptrieIP6Lookup::push(int, Packet *p)
+{
+	IP6Address gw;
+	int port = lookup_route(DST_IP6_ANNO(p), gw);
+
+	if (port < 0) {
+		p->kill();
+		return;
+	}
+	if (!addr_is_zero(gw))
+		SET_DST_IP6_ANNO(p, gw);
+	output(port).push(p);
+}
+
+void
+PoptrieIP6Lookup::push_batch(int, PacketBatch &batch)
+{
+	Packet *ps[BATCH_MAX];
+	IP6Address addrs[BATCH_MAX], gws[BATCH_MAX];
+	int ports[BATCH_MAX];
+	PacketBatch run;
+	int n, port = -1;
+
+	while (!batch.empty()) {
+		for (n = 0; n < BATCH_MAX && (ps[n] = batch.pop_front()); ++n)
+			addrs[n] = DST_IP6_ANNO(ps[n]);
+		lookup_batch(addrs, ports, gws, n);
+		for (int i = 0; i < n; ++i) {
+			if (ports[i] < 0) {
+				ps[i]->kill();
+				continue;
+			}
+			if (!addr_is_zero(gws[i]))
+				SET_DST_IP6_ANNO(ps[i], gws[i]);
+			if (ports[i] != port && !run.empty())
+				output_push_batch(port, run);
+			port = ports[i];
+			run.append(ps[i]);
+		}
+	}
+	if (!run.empty())
+		output_push_batch(port, run);
+}
+
+String
+PoptrieIP6Lookup::dump_routes() const
+{
+	StringAccum sa;
+
+	for (HashTable<String, int>::const_iterator it = _prefixes.begin();
+	     it.live(); ++it) {
+		const Route &r = _v[it.value()];
+
+		sa << r.addr.unparse() << '/' << r.prefix_len << '\t';
+		if (!addr_is_zero(r.gw))
+			sa << r.gw.unparse() << '\t';
+		sa << r.port << '\n';
+	}
+	return sa.take_string();
+}
+
+int
+PoptrieIP6Lookup::apply_lines(const String &s, PoptrieIP6Lookup *l, int op,
+		ErrorHandler *errh)
+{
+	const char *p = s.begin(), *end = s.end(), *nl;
+	int before = errh->nerrors();
+
+	for (; p < end; p = nl + 1) {
+		for (nl = p; nl < end && *nl != '\n'; ++nl)
+			/* nada */;
+		String line = cp_uncomment(s.substring(p, nl));
+		int lop = op, r = 0;
+		Route route;
+
+		if (!line.length())
+			continue;
+		if (lop == OP_CTRL) {
+			String word = cp_shift_spacevec(line);
+			if (word == "add")
+				lop = OP_ADD;
+			else if (word == "set")
+				lop = OP_SET;
+			else if (word == "remove")
+				lop = OP_REMOVE;
+			else {
+				errh->error("bad command %<%s%>", word.c_str());
+				continue;
+			}
+		}
+		if (!parse_route(line, route, lop == OP_REMOVE, l, errh))
+			continue;
+		if (lop == OP_REMOVE)
+			r = l->remove_route(route, errh);
+		else
+			r = l->add_route(route, lop == OP_SET, errh);
+		if (r == -EEXIST)
+			errh->error("route %<%s%> already exists", line.c_str());
+		else if (r == -ENOENT)
+			errh->error("no route %<%s%>", line.c_str());
+		else if (r == -ENOMEM)
+			errh->error("out of memory");
+	}
+	return errh->nerrors() == before ? 0 : -EINVAL;
+}
+
+int
+PoptrieIP6Lookup::write_handler(const String &s, Element *e, void *thunk,
+		ErrorHandler *errh)
+{
+	PoptrieIP6Lookup *l = static_cast<PoptrieIP6Lookup *>(e);
+
+	return apply_lines(s, l, (intptr_t) thunk, errh);
+}
+
+int
+PoptrieIP6Lookup::flush_handler(const String &, Element *e, void *,
+		ErrorHandler *errh)
+{
+	PoptrieIP6Lookup *l = static_cast<PoptrieIP6Lookup *>(e);
+	BNode root = { { -1, -1 }, -1 };
+	HashTable<String, int> prefixes;
+	Vector<BNode> bt;
+
+	/* Swap in an empty trie before dropping the routes it points to */
+	bt.push_back(root);
+	l->_bt.swap(bt);
+	l->_prefixes.swap(prefixes);
+	if (l->rebuild(l->_v) < 0) {
+		l->_bt.swap(bt);
+		l->_prefixes.swap(prefixes);
+		return errh->error("out of memory");
+	}
+	l->_btfree = -1;
+	l->_v.clear();
+	l->_vfree = -1;
+	return 0;
+}
+
+/* Builds the routes and binary trie of a binary table (see click_tables.h)
+ * in place of the live ones, which are kept aside until the new trie is
+ * swapped in.
+ */
+int
+PoptrieIP6Lookup::load_table(const String &data, ErrorHandler *errh)
+{
+	const struct click_route6 *r = (const struct click_route6 *)
+		(data.data() + sizeof(struct click_table_hdr));
+	long n = click_table_count(data.data(), data.length(),
+				   CLICK_TABLE_MAGIC_IP6, sizeof(*r));
+	BNode root = { { -1, -1 }, -1 };
+	HashTable<String, int> prefixes;
+	Vector<BNode> bt;
+	Vector<Route> v;
+
+	if (n < 0)
+		return errh->error("not a binary IPv6 route table");
+
+	bt.push_back(root);
+	_bt.swap(bt);
+	_prefixes.swap(prefixes);
+	_v.swap(v);
+	/* room to add routes before the array has to grow */
+	if (!_v.reserve(n + n / 8 + ROUTES_MIN)) {
+		errh->error("out of memory");
+		goto restore;
+	}
+
+	/* Later entries replace earlier ones for the same prefix */
+	for (long i = 0; i < n; ++i) {
+		Route route;
+		String key;
+
+		memcpy(route.addr.data(), r[i].addr, 16);
+		memcpy(route.gw.data(), r[i].gw, 16);
+		route.prefix_len = r[i].prefix_len;
+		route.port = click_table_be16(r[i].port);
+		route.extra = -1;
+		if (route.prefix_len > 128 || route.port >= noutputs()) {
+			errh->error("bad route %ld: %s/%d port %d", i,
+				    route.addr.unparse().c_str(),
+				    route.prefix_len, route.port);
+			goto restore;
+		}
+		mask_addr(route.addr, route.prefix_len);
+		key = prefix_key(route.addr, route.prefix_len);
+
+		HashTable<String, int>::iterator it = _prefixes.find(key);
+		if (it != _prefixes.end())
+			_v[it.value()] = route;
+		else {
+			_prefixes.set(key, _v.size());
+			bt_insert(route.addr, route.prefix_len, _v.size());
+			_v.push_back(route);
+		}
+		click_table_yield(i);
+	}
+	if (rebuild(_v) < 0) {
+		errh->error("out of memory");
+		goto restore;
+	}
+
+	/* The old trie goes away on the next swap, and with it the need
+	 * for its routes
+	 */
+	_old_v.swap(v);
+	_btfree = -1;
+	_vfree = -1;
+	return 0;
+
+restore:
+	_bt.swap(bt);
+	_prefixes.swap(prefixes);
+	_v.swap(v);
+	return -1;
+}
+
+int
+PoptrieIP6Lookup::load_handler(const String &data, Element *e, void *,
+		ErrorHandler *errh)
+{
+	return static_cast<PoptrieIP6Lookup *>(e)->load_table(data, errh);
+}
+
+int
+PoptrieIP6Lookup::lookup_handler(int, String &s, Element *e,
+		const Handler *, ErrorHandler *errh)
+{
+	PoptrieIP6Lookup *l = static_cast<PoptrieIP6Lookup *>(e);
+	IP6Address a, gw;
+	int port;
+
+	if (!IP6AddressArg().parse(cp_uncomment(s), a, e))
+		return errh->error("expected IPv6 address");
+	port = l->lookup_route(a, gw);
+	if (port >= 0 && !addr_is_zero(gw))
+		s = String(port) + " " + gw.unparse();
+	else
+		s = String(port);
+	return 0;
+}
+
+String
+PoptrieIP6Lookup::read_handler(Element *e, void *thunk)
+{
+	PoptrieIP6Lookup *l = static_cast<PoptrieIP6Lookup *>(e);
+	StringAccum sa;
+
+	if (thunk)
+		return l->dump_routes();
+	sa << "routes " << l->_prefixes.size() << '\n'
+	   << "nodes " << l->_t->nnodes << '/' << l->_t->cap_nodes << '\n'
+	   << "leaves " << l->_t->nleaves << '/' << l->_t->cap_leaves << '\n'
+	   << "garbage " << l->_t->garbage << '\n';
+	return sa.take_string();
+}
+
+void
+PoptrieIP6Lookup::add_handlers()
+{
+	add_write_handler("add", write_handler, OP_ADD);
+	add_write_handler("set", write_handler, OP_SET);
+	add_write_handler("remove", write_handler, OP_REMOVE);
+	add_write_handler("ctrl", write_handler, OP_CTRL);
+	add_write_handler("flush", flush_handler, 0);
+	add_write_handler("load", load_handler, 0);
+	add_read_handler("table", read_handler, 1);
+	add_read_handler("stats", read_handler, 0);
+	set_handler("lookup", Handler::f_read | Handler::f_read_param,
+		    lookup_handler);
+}
+
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+/* Prefix lengths of the global IPv6 table, in percent */
+static const struct {
+	uint8_t len;
+	uint8_t pct;
+} selftest_lens[] = {
+	{ 48, 46 }, { 32, 12 }, { 44, 9 }, { 40, 8 }, { 29, 4 }, { 36, 4 },
+	{ 46, 3 }, { 47, 3 }, { 42, 2 }, { 45, 2 }, { 33, 2 }, { 28, 2 },
+	{ 64, 2 }, { 56, 1 }
+};
+
+static uint32_t
+selftest_rand(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* A random global unicast address, or one below prefix/len if len > 0 */
+static IP6Address
+selftest_addr(uint32_t *state, const IP6Address &prefix, int len)
+{
+	IP6Address a;
+	unsigned char *d = a.data();
+	const unsigned char *p = prefix.data();
+
+	for (int i = 0; i < 16; ++i)
+		d[i] = selftest_rand(state);
+	d[0] = 0x20 | (d[0] & 0x1F);
+	for (int i = 0; i < 16 && len > i * 8; ++i) {
+		int bits = len - i * 8;
+		uint8_t m = bits >= 8 ? 0xFF : 0xFF << (8 - bits);
+
+		d[i] = (p[i] & m) | (d[i] & ~m);
+	}
+	return a;
+}
+
+static inline bool
+selftest_same(int port, const IP6Address &gw, int ref_port,
+	      const IP6Address &ref_gw)
+{
+	return port == ref_port && (port < 0 || gw == ref_gw);
+}
+
+/* Builds a table of nroutes prefixes, half of them below earlier ones so
+ * longest-prefix matching matters, and looks up nlookups addresses with
+ * the trie, one at a time and batched, and with Click's IP6Table.
+ */
+int
+PoptrieIP6Lookup::selftest(int nroutes, int nlookups)
+{
+	PoptrieIP6Lookup *l = new PoptrieIP6Lookup;
+	IP6Table ref;
+	Vector<IP6Address> addrs, gws, ref_gws;
+	Vector<int> ports, ref_ports;
+	uint32_t state = 0x2545f491;
+	click_cycles_t c0, c1, c2, c3;
+	int errors = 0, hits = 0;
+
+	if (!l)
+		return -1;
+	for (int i = 0; i < nroutes; ++i) {
+		uint32_t x = selftest_rand(&state) % 100;
+		Route r;
+		int k;
+
+		for (k = 0; x >= selftest_lens[k].pct; ++k)
+			x -= selftest_lens[k].pct;
+		r.prefix_len = selftest_lens[k].len;
+		r.addr = selftest_addr(&state, IP6Address(), 0);
+		if (l->_v.size() && (selftest_rand(&state) & 1)) {
+			const Route &up = l->_v[selftest_rand(&state) % l->_v.size()];
+			if (up.prefix_len < r.prefix_len)
+				r.addr = selftest_addr(&state, up.addr, up.prefix_len);
+		}
+		mask_addr(r.addr, r.prefix_len);
+		r.gw = (selftest_rand(&state) & 3) ? IP6Address()
+			: selftest_addr(&state, IP6Address(), 0);
+		r.port = selftest_rand(&state) % 8;
+		r.extra = -1;
+
+		String key = prefix_key(r.addr, r.prefix_len);
+		if (l->_prefixes.find(key) != l->_prefixes.end())
+			continue;
+		if (l->_v.size() == l->_v.capacity() && l->grow_routes() < 0)
+			break;
+		l->_prefixes.set(key, l->_v.size());
+		l->bt_insert(r.addr, r.prefix_len, l->_v.size());
+		l->_v.push_back(r);
+		ref.add(r.addr, IP6Address::make_prefix(r.prefix_len), r.gw,
+			r.port);
+	}
+	if (l->rebuild(l->_v) < 0) {
+		uk_pr_err("poptrie selftest: out of memory\n");
+		delete l;
+		return -1;
+	}
+
+	/* Three quarters of the addresses fall below a route */
+	for (int i = 0; i < nlookups; ++i) {
+		if (selftest_rand(&state) & 3) {
+			const Route &r = l->_v[selftest_rand(&state) % l->_v.size()];
+			addrs.push_back(selftest_addr(&state, r.addr, r.prefix_len));
+		} else
+			addrs.push_back(selftest_addr(&state, IP6Address(), 0));
+	}
+	ports.resize(nlookups, -1);
+	gws.resize(nlookups);
+	ref_ports.resize(nlookups, -1);
+	ref_gws.resize(nlookups);
+
+	c0 = click_get_cycles();
+	for (int i = 0; i < nlookups; ++i)
+		ports[i] = l->lookup_route(addrs[i], gws[i]);
+	c1 = click_get_cycles();
+	for (int i = 0; i < nlookups; ++i)
+		if (!ref.lookup(addrs[i], ref_gws[i], ref_ports[i]))
+			ref_ports[i] = -1;
+	c2 = click_get_cycles();
+	for (int i = 0; i < nlookups; ++i)
+		if (!selftest_same(ports[i], gws[i], ref_ports[i], ref_gws[i])) {
+			if (++errors <= 8)
+				uk_pr_err("poptrie selftest: %s: %d %s, IP6Table %d %s\n",
+					  addrs[i].unparse().c_str(), ports[i],
+					  gws[i].unparse().c_str(), ref_ports[i],
+					  ref_gws[i].unparse().c_str());
+		} else if (ports[i] >= 0)
+			++hits;
+
+	c3 = click_get_cycles();
+	l->lookup_batch(addrs.begin(), ports.begin(), gws.begin(), nlookups);
+	c3 = click_get_cycles() - c3;
+	for (int i = 0; i < nlookups; ++i)
+		if (!selftest_same(ports[i], gws[i], ref_ports[i], ref_gws[i])
+		    && ++errors <= 8)
+			uk_pr_err("poptrie selftest: %s: batched %d, IP6Table %d\n",
+				  addrs[i].unparse().c_str(), ports[i],
+				  ref_ports[i]);
+
+	uk_pr_info("poptrie selftest: %d routes, %d lookups (%d hits), %d mismatches\n",
+		   l->_v.size(), nlookups, hits, errors);
+	uk_pr_info("poptrie selftest: cycles per lookup: poptrie %lu, batched %lu, IP6Table %lu\n",
+		   (unsigned long) ((c1 - c0) / nlookups),
+		   (unsigned long) (c3 / nlookups),
+		   (unsigned long) ((c2 - c1) / nlookups));
+	l->cleanup(CLEANUP_NO_ROUTER);
+	delete l;
+	return errors;
+}
+#endif /* CONFIG_LIBCLICK_LOOKUP_SELFTEST */
+
+CLICK_ENDDECLS
+
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+int
+click_lookup_selftest(void)
+{
+	CLICK_USING_DECLS
+	return PoptrieIP6Lookup::selftest(CONFIG_LIBCLICK_LOOKUP_SELFTEST_ROUTES,
+					  4096);
+}
+#endif
+ELEMENT_REQUIRES(BatchElement)
+EXPORT_ELEMENT(PoptrieIP6Lookup)
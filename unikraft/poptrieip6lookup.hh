@@ -0,0 +1,217 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_POPTRIEIP6LOOKUP_HH
+#define CLICK_POPTRIEIP6LOOKUP_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/hashtable.hh>
+#include <click/ip6address.hh>
+#include <click/vector.hh>
+#include "batchelement.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+PoptrieIP6Lookup(ADDR1/PREFIXLEN1 [GW1] OUT1, ADDR2/PREFIXLEN2 [GW2] OUT2, ..., I<keywords> TABLE)
+
+=s ip6
+
+IPv6 routing lookup using a compressed multibit trie
+
+=d
+
+Expects an IPv6 packet with its destination address annotation set, looks
+up the longest matching route and emits the packet on the route's output
+port, setting the destination annotation to the route's gateway if it has
+one. Packets without a matching route are dropped.
+
+The first 16 address bits index a direct table; below that, every trie node
+covers 6 bits and stores which of its 64 slots are subtrees and where runs
+of identical results start as two bitmaps, so children and results are found
+with a population count instead of following per-slot pointers (Poptrie).
+A lookup touches one cache line per level below the direct table: three for
+a /32, six for the common /48 and eight for a /64. Batches from batch-capable elements are looked up
+32 packets at a time, one trie level for all of them after the other.
+
+Updates rebuild only the subtrees under the affected direct-table entries,
+next to the live ones, and then switch the entry over. The whole trie is
+rebuilt and swapped in when the spare space runs out, and when a binary
+table is loaded.
+
+Large tables load much faster in the binary format of click_tables.h,
+which click-mktable writes from the usual text routes.
+
+Keyword arguments are:
+
+=over 8
+
+=item TABLE
+
+String. Name of a member of the initrd archive holding a binary table to
+start with. Routes given as arguments are added to it.
+
+=back
+
+=h add, set, remove, ctrl, table, lookup, flush
+
+Same as for the IPv4 IPRouteTable elements.
+
+=h load write-only
+
+Replaces all routes with the binary table written.
+
+=h stats read-only
+
+Returns the number of routes, trie nodes and leaves.
+
+=a LookupIP6Route, Dir248IPLookup, IPRouteTable
+*/
+
+class PoptrieIP6Lookup : public BatchElement { public:
+
+    PoptrieIP6Lookup();
+    ~PoptrieIP6Lookup();
+
+    const char *class_name() const	{ return "PoptrieIP6Lookup"; }
+    const char *port_count() const	{ return "1/-"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void push(int, Packet *);
+    void push_batch(int, PacketBatch &);
+
+    struct Route {
+	IP6Address addr;
+	int prefix_len;
+	IP6Address gw;
+	int port;
+	int extra;
+    };
+
+    int add_route(const Route &, bool allow_replace, ErrorHandler *);
+    int remove_route(const Route &, ErrorHandler *);
+    int lookup_route(const IP6Address &, IP6Address &gw) const;
+    void lookup_batch(const IP6Address *addrs, int *ports, IP6Address *gws,
+		      int n) const;
+    String dump_routes() const;
+
+#if CONFIG_LIBCLICK_LOOKUP_SELFTEST
+    static int selftest(int nroutes, int nlookups);
+#endif
+
+  private:
+
+    struct Node {
+	uint64_t vector;	// slots that are subtrees
+	uint64_t leafvec;	// slots that start a new run of leaves
+	uint32_t base0;		// first leaf
+	uint32_t base1;		// first child
+    };
+
+    // Binary trie of the configured prefixes, source for (re)building
+    struct BNode {
+	int child[2];
+	int route;
+    };
+
+    struct Trie {
+	const Route *routes;	// what leaves index (minus one), _v's storage
+	uint32_t *dp;
+	uint32_t *dp_used;	// nodes and leaves used below each dp entry
+	Node *nodes;
+	uint32_t nnodes, cap_nodes;
+	uint32_t *leaves;
+	uint32_t nleaves, cap_leaves;
+	uint32_t garbage;
+    };
+
+    enum {
+	DP_BITS = 16, DP_SIZE = 1 << DP_BITS, STRIDE = 6, BATCH_MAX = 32,
+	ROUTES_MIN = 1024
+    };
+    static const uint32_t DP_NODE = 0x80000000U;
+
+    Trie *_t;
+    Trie *_old_t;
+
+    Vector<Route> _v;		// never reallocated in place, see grow_routes()
+    Vector<Route> _old_v;	// storage _old_t's routes point to
+    int _vfree;
+    HashTable<String, int> _prefixes;
+    Vector<BNode> _bt;
+    int _btfree;
+
+    static String prefix_key(const IP6Address &, int);
+    static bool parse_route(const String &, Route &, bool remove,
+			    Element *, ErrorHandler *);
+
+    int bt_alloc();
+    void bt_insert(const IP6Address &, int prefix_len, int route);
+    bool bt_remove(int n, const IP6Address &, int depth, int prefix_len);
+    int bt_walk(int n, uint32_t bits, int len, int &best) const;
+    inline bool bt_internal(int n) const {
+	return _bt[n].child[0] >= 0 || _bt[n].child[1] >= 0;
+    }
+
+    Trie *alloc_trie(uint32_t cap_nodes, uint32_t cap_leaves);
+    static void free_trie(Trie *);
+    void swap_trie(Trie *);
+    bool build_node(Trie *, int bn, int off, int inherited, uint32_t idx);
+    bool build_dp(Trie *, uint32_t i);
+    int rebuild(const Vector<Route> &v);
+    int grow_routes();
+    int update(const IP6Address &, int prefix_len);
+    int load_table(const String &data, ErrorHandler *errh);
+
+    enum { OP_ADD, OP_SET, OP_REMOVE, OP_CTRL };
+    static int apply_lines(const String &, PoptrieIP6Lookup *, int op,
+			   ErrorHandler *);
+    static int write_handler(const String &, Element *, void *,
+			     ErrorHandler *);
+    static int load_handler(const String &, Element *, void *,
+			    ErrorHandler *);
+    static int flush_handler(const String &, Element *, void *,
+			     ErrorHandler *);
+    static int lookup_handler(int, String &, Element *, const Handler *,
+			      ErrorHandler *);
+    static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
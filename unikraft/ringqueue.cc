@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if CONFIG_LIBCLICK_TRACE
+#define UK_DEBUG_TRACE
+#endif
+#include "ringqueue.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <uk/trace.h>
+
+UK_TRACEPOINT(trace_click_enqueue, "elem=%u pkt=%lx",
+	      unsigned, unsigned long);
+UK_TRACEPOINT(trace_click_dequeue, "elem=%u pkt=%lx",
+	      unsigned, unsigned long);
+UK_TRACEPOINT(trace_click_drop, "elem=%u pkt=%lx",
+	      unsigned, unsigned long);
+
+CLICK_DECLS
+
+template <typename R>
+RingQueue<R>::RingQueue()
+	: _trace(false), _cache_pos(0), _cache_len(0), _burst(32)
+{
+	_drops = 0;
+}
+
+template <typename R>
+void *
+RingQueue<R>::cast(const char *n)
+{
+	if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+		return static_cast<Notifier *>(&_empty_note);
+	return BatchElement::cast(n);
+}
+
+template <typename R>
+int
+RingQueue<R>::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	uint32_t capacity = 1024;
+
+	if (Args(conf, this, errh)
+			.read_p("CAPACITY", capacity)
+			.read("BURST", _burst)
+			.read("TRACE", _trace)
+			.complete() < 0)
+		return -1;
+
+	if (capacity < 1 || capacity > (1U << 30))
+		return errh->error("CAPACITY must be between 1 and 2^30");
+	if (_burst < 1 || _burst > BURST_MAX)
+		return errh->error("BURST must be between 1 and %d", BURST_MAX);
+	if (_ring.initialize(capacity) < 0)
+		return errh->error("out of memory");
+
+	_empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+	return 0;
+}
+
+template <typename R>
+void
+RingQueue<R>::cleanup(CleanupStage)
+{
+	Packet *p;
+
+	for (; _cache_pos < _cache_len; ++_cache_pos)
+		_cache[_cache_pos]->kill();
+	while (_ring.dequeue(p))
+		p->kill();
+}
+
+/* The consumer clears the notifier and then checks the ring once more; the
+ * producer publishes its packet and then checks the notifier. Both sides
+ * need a full fence in between, or each may miss the other's write.
+ */
+template <typename R>
+inline void
+RingQueue<R>::wake_consumer()
+{
+	click_fence();
+	if (!_empty_note.active())
+		_empty_note.wake();
+}
+
+template <typename R>
+void
+RingQueue<R>::push(int, Packet *p)
+{
+	if (unlikely(_trace))
+		trace_click_enqueue(eindex(), (unsigned long) p);
+	if (likely(_ring.enqueue(p)))
+		wake_consumer();
+	else {
+		if (unlikely(_trace))
+			trace_click_drop(eindex(), (unsigned long) p);
+		_drops++;
+		p->kill();
+	}
+}
+
+template <typename R>
+void
+RingQueue<R>::push_batch(int, PacketBatch &batch)
+{
+	Packet *v[BURST_MAX];
+	uint32_t n, sent, total = 0;
+
+	while (!batch.empty()) {
+		for (n = 0; n < BURST_MAX && !batch.empty(); ++n)
+			v[n] = batch.pop_front();
+		sent = _ring.enqueue_burst(v, n);
+		if (unlikely(_trace))
+			for (uint32_t i = 0; i < sent; ++i)
+				trace_click_enqueue(eindex(), (unsigned long) v[i]);
+		for (uint32_t i = sent; i < n; ++i) {
+			if (unlikely(_trace))
+				trace_click_drop(eindex(), (unsigned long) v[i]);
+			_drops++;
+			v[i]->kill();
+		}
+		total += sent;
+	}
+	if (likely(total))
+		wake_consumer();
+}
+
+/* Refills the consumer cache; puts the notifier to sleep if the ring is
+ * empty.
+ */
+template <typename R>
+inline bool
+RingQueue<R>::refill()
+{
+	_cache_pos = 0;
+	_cache_len = _ring.dequeue_burst(_cache, _burst);
+	if (_cache_len)
+		return true;
+	if (_empty_note.active()) {
+		_empty_note.sleep();
+		click_fence();
+		if (!_ring.empty())
+			_empty_note.wake();
+	}
+	return false;
+}
+
+template <typename R>
+Packet *
+RingQueue<R>::pull(int)
+{
+	if (_cache_pos == _cache_len && !refill())
+		return 0;
+	if (unlikely(_trace))
+		trace_click_dequeue(eindex(), (unsigned long) _cache[_cache_pos]);
+	return _cache[_cache_pos++];
+}
+
+template <typename R>
+void
+RingQueue<R>::pull_batch(int, unsigned max, PacketBatch &batch)
+{
+	for (unsigned i = 0; i < max; ++i) {
+		if (_cache_pos == _cache_len && !refill())
+			break;
+		if (unlikely(_trace))
+			trace_click_dequeue(eindex(), (unsigned long) _cache[_cache_pos]);
+		batch.append(_cache[_cache_pos++]);
+	}
+}
+
+template <typename R>
+String
+RingQueue<R>::read_handler(Element *e, void *thunk)
+{
+	RingQueue<R> *q = static_cast<RingQueue<R> *>(e);
+
+	switch ((intptr_t) thunk) {
+	case 0:
+		return String(q->_ring.size() + q->_cache_len - q->_cache_pos);
+	case 1:
+		return String(q->_ring.capacity());
+	default:
+		return String(q->_drops.value());
+	}
+}
+
+template <typename R>
+void
+RingQueue<R>::add_handlers()
+{
+	add_read_handler("length", read_handler, 0);
+	add_read_handler("capacity", read_handler, 1);
+	add_read_handler("drops", read_handler, 2);
+	add_data_handlers("trace", Handler::f_read | Handler::f_write | Handler::f_checkbox, &_trace);
+}
+
+template class RingQueue<SPSCRing<Packet *> >;
+template class RingQueue<MPSCRing<Packet *> >;
+
+SPSCQueue::SPSCQueue()
+{
+}
+
+MPSCQueue::MPSCQueue()
+{
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(BatchElement)
+EXPORT_ELEMENT(SPSCQueue)
+EXPORT_ELEMENT(MPSCQueue)
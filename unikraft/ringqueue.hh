@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_RINGQUEUE_HH
+#define CLICK_RINGQUEUE_HH
+
+#include <click/config.h>
+#include <click/atomic.hh>
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include "batchelement.hh"
+#include "lfring.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+SPSCQueue([CAPACITY, I<keywords> BURST, TRACE])
+
+=s threads
+
+lock-free queue for one producer and one consumer thread
+
+=d
+
+Stores incoming packets in a lock-free ring until they are pulled. Packets
+arriving when the ring is full are dropped. Unlike ThreadSafeQueue, the push
+and pull sides share no lock and, in steady state, no cache line: each side
+caches the other's ring index and only rereads it when the ring looks full
+or empty.
+
+The consumer dequeues up to BURST packets at a time into a private cache
+and hands them out one per pull. Downstream tasks are woken through the
+empty notifier, which the producer only signals when the consumer had gone
+to sleep on an empty ring.
+
+Only one thread may push into an SPSCQueue. Use MPSCQueue when several
+threads push into the same queue.
+
+Keyword arguments are:
+
+=over 8
+
+=item CAPACITY
+
+Integer. Rounded up to a power of two. Default is 1024.
+
+=item BURST
+
+Integer. Number of packets dequeued from the ring at once. Default is 32.
+
+=item TRACE
+
+Boolean. Record every packet entering, leaving or dropped by the queue as
+Unikraft tracepoints (needs LIBCLICK_TRACE). Default is false.
+
+=back
+
+=h length read-only
+
+Returns the approximate number of packets queued.
+
+=h capacity read-only
+
+Returns the ring size.
+
+=h drops read-only
+
+Returns the number of packets dropped because the ring was full.
+
+=h trace read/write
+
+Whether tracing is on; can be changed at run time.
+
+=a MPSCQueue, ThreadSafeQueue, Queue
+*/
+
+/*
+=c
+
+MPSCQueue([CAPACITY, I<keywords> BURST, TRACE])
+
+=s threads
+
+lock-free queue for many producer threads and one consumer thread
+
+=d
+
+Like SPSCQueue, but any number of threads may push into it. Producers
+reserve ring slots with a compare-and-swap and publish them in order.
+
+=a SPSCQueue, ThreadSafeQueue
+*/
+
+template <typename R>
+class RingQueue : public BatchElement { public:
+
+    RingQueue();
+
+    const char *port_count() const	{ return PORTS_1_1; }
+    const char *processing() const	{ return PUSH_TO_PULL; }
+    void *cast(const char *);
+
+    int configure(Vector<String> &, ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void push(int, Packet *);
+    Packet *pull(int);
+    void push_batch(int, PacketBatch &);
+    void pull_batch(int, unsigned, PacketBatch &);
+
+  protected:
+
+    enum { BURST_MAX = 256 };
+
+    R _ring;
+    ActiveNotifier _empty_note;
+    atomic_uint32_t _drops;
+    bool _trace;
+
+    // consumer-private
+    Packet *_cache[BURST_MAX];
+    uint32_t _cache_pos;
+    uint32_t _cache_len;
+    uint32_t _burst;
+
+    inline void wake_consumer();
+    inline bool refill();
+    static String read_handler(Element *, void *);
+
+};
+
+class SPSCQueue : public RingQueue<SPSCRing<Packet *> > { public:
+
+    SPSCQueue();
+
+    const char *class_name() const	{ return "SPSCQueue"; }
+
+};
+
+class MPSCQueue : public RingQueue<MPSCRing<Packet *> > { public:
+
+    MPSCQueue();
+
+    const char *class_name() const	{ return "MPSCQueue"; }
+
+};
+
+CLICK_ENDDECLS
+#endif
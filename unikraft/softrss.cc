@@ -0,0 +1,383 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "softrss.hh"
+
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/straccum.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+
+CLICK_DECLS
+
+/* Microsoft's default RSS key */
+static const uint8_t default_key[] = {
+	0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+	0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+	0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+	0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+	0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+static int
+hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+SoftRSS::SoftRSS()
+	: _ports(true), _burst(32)
+{
+}
+
+SoftRSS::~SoftRSS()
+{
+}
+
+void *
+SoftRSS::port_cast(bool isoutput, int port, const char *name)
+{
+	if (isoutput && port < _lanes.size()
+	    && strcmp(name, Notifier::EMPTY_NOTIFIER) == 0)
+		return static_cast<Notifier *>(&_lanes[port]->empty_note);
+	return Element::port_cast(isoutput, port, name);
+}
+
+/* Precomputes, for every input byte position and value, the XOR of the
+ * 32-bit key windows selected by its set bits, so hashing takes one
+ * lookup per byte instead of one shift per bit.
+ */
+void
+SoftRSS::set_key(const uint8_t *key)
+{
+	for (int i = 0; i < HASH_MAX; ++i)
+		for (int v = 0; v < 256; ++v) {
+			uint32_t h = 0;
+			for (int b = 0; b < 8; ++b) {
+				if (!(v & (0x80 >> b)))
+					continue;
+				int bit = i * 8 + b, k = bit / 8, s = bit % 8;
+				uint64_t w = ((uint64_t) key[k] << 32)
+					| ((uint64_t) key[k + 1] << 24)
+					| ((uint64_t) key[k + 2] << 16)
+					| ((uint64_t) key[k + 3] << 8)
+					| key[k + 4];
+				h ^= (uint32_t) (w >> (8 - s));
+			}
+			_table[i][v] = h;
+		}
+}
+
+int
+SoftRSS::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	String fields = "ip-port", key;
+	uint32_t capacity = 1024;
+	uint8_t kb[KEY_LEN];
+
+	if (Args(conf, this, errh)
+			.read("FIELDS", WordArg(), fields)
+			.read("KEY", WordArg(), key)
+			.read("CAPACITY", capacity)
+			.read("BURST", _burst)
+			.complete() < 0)
+		return -1;
+
+	if (fields == "ip")
+		_ports = false;
+	else if (fields == "ip-port")
+		_ports = true;
+	else
+		return errh->error("FIELDS must be ip or ip-port");
+	if (capacity < 1 || capacity > (1U << 30))
+		return errh->error("CAPACITY must be between 1 and 2^30");
+	if (_burst < 1 || _burst > BURST_MAX)
+		return errh->error("BURST must be between 1 and %d", BURST_MAX);
+
+	if (key) {
+		if (key.length() != 2 * KEY_LEN)
+			return errh->error("KEY must be %d hexadecimal digits", 2 * KEY_LEN);
+		for (int i = 0; i < KEY_LEN; ++i) {
+			int hi = hex_digit(key[2 * i]), lo = hex_digit(key[2 * i + 1]);
+			if (hi < 0 || lo < 0)
+				return errh->error("KEY must be %d hexadecimal digits", 2 * KEY_LEN);
+			kb[i] = (hi << 4) | lo;
+		}
+		set_key(kb);
+	} else
+		set_key(default_key);
+
+	if (noutputs() > RETA_SIZE)
+		return errh->error("SoftRSS has at most %d outputs", RETA_SIZE);
+	for (int i = 0; i < RETA_SIZE; ++i)
+		_reta[i] = i % noutputs();
+
+	for (int i = 0; i < noutputs(); ++i) {
+		Lane *l = new Lane;
+		if (!l || l->ring.initialize(capacity) < 0) {
+			delete l;
+			return errh->error("out of memory");
+		}
+		l->packets = l->drops = 0;
+		l->cache_pos = l->cache_len = 0;
+		l->empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+		_lanes.push_back(l);
+	}
+	return 0;
+}
+
+void
+SoftRSS::cleanup(CleanupStage)
+{
+	Packet *p;
+
+	for (int i = 0; i < _lanes.size(); ++i) {
+		Lane *l = _lanes[i];
+		for (; l->cache_pos < l->cache_len; ++l->cache_pos)
+			l->cache[l->cache_pos]->kill();
+		while (l->ring.dequeue(p))
+			p->kill();
+		delete l;
+	}
+	_lanes.clear();
+}
+
+inline uint32_t
+SoftRSS::toeplitz(const uint8_t *d, int len) const
+{
+	uint32_t h = 0;
+
+	for (int i = 0; i < len; ++i)
+		h ^= _table[i][d[i]];
+	return h;
+}
+
+/* Hashes addresses, then ports, in the order NICs feed them to Toeplitz */
+uint32_t
+SoftRSS::flow_hash(Packet *p) const
+{
+	const unsigned char *d = p->data();
+	uint32_t len = p->length(), l3 = sizeof(click_ether), l4;
+	uint8_t in[HASH_MAX];
+	uint16_t type;
+	int n;
+
+	if (len < l3)
+		return 0;
+	type = reinterpret_cast<const click_ether *>(d)->ether_type;
+	if (type == htons(ETHERTYPE_8021Q)) {
+		if (len < l3 + 4)
+			return 0;
+		type = *reinterpret_cast<const uint16_t *>(d + l3 + 2);
+		l3 += 4;
+	}
+
+	if (type == htons(ETHERTYPE_IP)) {
+		const click_ip *iph = reinterpret_cast<const click_ip *>(d + l3);
+		if (len < l3 + sizeof(click_ip))
+			return 0;
+		memcpy(in, &iph->ip_src, 8);
+		n = 8;
+		l4 = l3 + (iph->ip_hl << 2);
+		if (_ports && (iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+		    && !(iph->ip_off & htons(IP_MF | IP_OFFMASK)) && len >= l4 + 4) {
+			memcpy(in + n, d + l4, 4);
+			n += 4;
+		}
+	} else if (type == htons(ETHERTYPE_IP6)) {
+		const click_ip6 *ip6 = reinterpret_cast<const click_ip6 *>(d + l3);
+		if (len < l3 + sizeof(click_ip6))
+			return 0;
+		memcpy(in, &ip6->ip6_src, 32);
+		n = 32;
+		l4 = l3 + sizeof(click_ip6);
+		if (_ports && (ip6->ip6_nxt == IP_PROTO_TCP || ip6->ip6_nxt == IP_PROTO_UDP)
+		    && len >= l4 + 4) {
+			memcpy(in + n, d + l4, 4);
+			n += 4;
+		}
+	} else
+		return 0;
+
+	return toeplitz(in, n);
+}
+
+/* pairs with the fence in refill(), see RingQueue */
+inline void
+SoftRSS::wake(Lane *l)
+{
+	click_fence();
+	if (!l->empty_note.active())
+		l->empty_note.wake();
+}
+
+void
+SoftRSS::push(int, Packet *p)
+{
+	Lane *l = _lanes[_reta[flow_hash(p) % RETA_SIZE]];
+
+	if (likely(l->ring.enqueue(p))) {
+		l->packets++;
+		wake(l);
+	} else {
+		l->drops++;
+		p->kill();
+	}
+}
+
+/* Hashes a chunk of the batch, then moves each lane's share into its ring
+ * with one burst and at most one wakeup.
+ */
+void
+SoftRSS::push_batch(int, PacketBatch &batch)
+{
+	enum { CHUNK = 64 };
+	Packet *v[CHUNK], *mine[CHUNK];
+	uint8_t lane[CHUNK];
+	uint32_t n, m, sent;
+
+	while (!batch.empty()) {
+		for (n = 0; n < CHUNK && !batch.empty(); ++n) {
+			v[n] = batch.pop_front();
+			lane[n] = _reta[flow_hash(v[n]) % RETA_SIZE];
+		}
+		for (int i = 0; i < _lanes.size(); ++i) {
+			Lane *l = _lanes[i];
+
+			for (uint32_t j = m = 0; j < n; ++j)
+				if (lane[j] == i)
+					mine[m++] = v[j];
+			if (!m)
+				continue;
+			sent = l->ring.enqueue_burst(mine, m);
+			l->packets += sent;
+			l->drops += m - sent;
+			for (uint32_t j = sent; j < m; ++j)
+				mine[j]->kill();
+			if (sent)
+				wake(l);
+		}
+	}
+}
+
+inline bool
+SoftRSS::refill(Lane *l)
+{
+	l->cache_pos = 0;
+	l->cache_len = l->ring.dequeue_burst(l->cache, _burst);
+	if (l->cache_len)
+		return true;
+	if (l->empty_note.active()) {
+		l->empty_note.sleep();
+		click_fence();
+		if (!l->ring.empty())
+			l->empty_note.wake();
+	}
+	return false;
+}
+
+Packet *
+SoftRSS::pull(int port)
+{
+	Lane *l = _lanes[port];
+
+	if (l->cache_pos == l->cache_len && !refill(l))
+		return 0;
+	return l->cache[l->cache_pos++];
+}
+
+void
+SoftRSS::pull_batch(int port, unsigned max, PacketBatch &batch)
+{
+	Lane *l = _lanes[port];
+
+	for (unsigned i = 0; i < max; ++i) {
+		if (l->cache_pos == l->cache_len && !refill(l))
+			break;
+		batch.append(l->cache[l->cache_pos++]);
+	}
+}
+
+String
+SoftRSS::read_handler(Element *e, void *thunk)
+{
+	SoftRSS *rss = static_cast<SoftRSS *>(e);
+	StringAccum sa;
+	uint64_t max = 0, total = 0;
+
+	for (int i = 0; i < rss->_lanes.size(); ++i) {
+		const Lane *l = rss->_lanes[i];
+		if (!thunk)
+			sa << l->packets << ' ' << l->drops << ' '
+			   << l->ring.size() << '\n';
+		if (l->packets > max)
+			max = l->packets;
+		total += l->packets;
+	}
+	if (thunk) {
+		/* max / (total / n), two decimals */
+		uint64_t r = total ? max * rss->_lanes.size() * 100 / total : 100;
+		sa.snprintf(32, "%llu.%02llu", (unsigned long long) r / 100,
+			    (unsigned long long) r % 100);
+	}
+	return sa.take_string();
+}
+
+int
+SoftRSS::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	SoftRSS *rss = static_cast<SoftRSS *>(e);
+
+	for (int i = 0; i < rss->_lanes.size(); ++i)
+		rss->_lanes[i]->packets = rss->_lanes[i]->drops = 0;
+	return 0;
+}
+
+void
+SoftRSS::add_handlers()
+{
+	add_read_handler("stats", read_handler, 0);
+	add_read_handler("imbalance", read_handler, 1);
+	add_write_handler("reset", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(BatchElement)
+EXPORT_ELEMENT(SoftRSS)
@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_SOFTRSS_HH
+#define CLICK_SOFTRSS_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/vector.hh>
+#include "batchelement.hh"
+#include "lfring.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+SoftRSS([I<keywords> FIELDS, KEY, CAPACITY, BURST])
+
+=s threads
+
+spreads flows over per-thread rings like receive side scaling
+
+=d
+
+Computes the Toeplitz hash a NIC with receive side scaling would compute
+for each pushed Ethernet frame and stores the frame in one of several
+lock-free rings, chosen through a 128-entry indirection table. Output
+port I is the pull end of ring I, so placing the task pulling from each
+output on its own thread (StaticThreadSched) spreads the processing of a
+single-queue device over several threads while all packets of a flow stay
+on one of them.
+
+IPv4 and IPv6 frames, optionally VLAN tagged, are hashed; everything else
+goes to output 0. Only one thread may push into a SoftRSS, and each output
+must be pulled by a single thread.
+
+Keyword arguments are:
+
+=over 8
+
+=item FIELDS
+
+Either C<ip> to hash source and destination addresses only, or C<ip-port>
+to include TCP and UDP ports where present. IPv4 fragments and IPv6
+packets with extension headers are hashed by address. Default is
+C<ip-port>.
+
+=item KEY
+
+Hash key as 80 hexadecimal digits. Default is the key from Microsoft's
+RSS specification, so results match NICs using that default.
+
+=item CAPACITY
+
+Integer. Size of each ring, rounded up to a power of two. Default is 1024.
+
+=item BURST
+
+Integer. Number of packets dequeued from a ring at once. Default is 32.
+
+=back
+
+=h stats read-only
+
+Returns one line per output: packets enqueued, packets dropped because
+the ring was full, and packets currently queued.
+
+=h imbalance read-only
+
+Returns the largest number of packets sent to one output divided by the
+mean over all outputs. 1 means perfectly even spreading.
+
+=h reset write-only
+
+Clears the counters.
+
+=a SPSCQueue, StaticThreadSched
+*/
+
+class SoftRSS : public BatchElement { public:
+
+    SoftRSS();
+    ~SoftRSS();
+
+    const char *class_name() const	{ return "SoftRSS"; }
+    const char *port_count() const	{ return "1/1-"; }
+    const char *processing() const	{ return PUSH_TO_PULL; }
+    void *port_cast(bool, int, const char *);
+
+    int configure(Vector<String> &, ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void push(int, Packet *);
+    Packet *pull(int);
+    void push_batch(int, PacketBatch &);
+    void pull_batch(int, unsigned, PacketBatch &);
+
+  private:
+
+    enum { KEY_LEN = 40, HASH_MAX = 36, RETA_SIZE = 128, BURST_MAX = 256 };
+
+    struct Lane {
+	SPSCRing<Packet *> ring;
+	ActiveNotifier empty_note;
+	// producer
+	uint64_t packets LFRING_ALIGN;
+	uint64_t drops;
+	// consumer
+	Packet *cache[BURST_MAX] LFRING_ALIGN;
+	uint32_t cache_pos;
+	uint32_t cache_len;
+    };
+
+    Vector<Lane *> _lanes;
+    uint8_t _reta[RETA_SIZE];
+    uint32_t _table[HASH_MAX][256];
+    bool _ports;
+    uint32_t _burst;
+
+    void set_key(const uint8_t *);
+    inline uint32_t toeplitz(const uint8_t *, int) const;
+    uint32_t flow_hash(Packet *) const;
+    inline void wake(Lane *);
+    inline bool refill(Lane *);
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,501 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "threadplanner.hh"
+#include "cycleprofiler.hh"
+
+#include <click/args.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/handler.hh>
+#include <click/master.hh>
+#include <click/router.hh>
+#include <click/routerthread.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+ThreadPlanner::ThreadPlanner()
+	: _timer(this), _planned(false)
+{
+}
+
+ThreadPlanner::~ThreadPlanner()
+{
+}
+
+int
+ThreadPlanner::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+	_nthreads = master()->nthreads();
+	_calibrate = Timestamp(1, 0);
+	_apply = true;
+	_split = true;
+	_burst = 32;
+
+	if (Args(conf, this, errh)
+			.read("THREADS", _nthreads)
+			.read("CALIBRATE", _calibrate)
+			.read("APPLY", _apply)
+			.read("SPLIT", _split)
+			.read("BURST", _burst)
+			.complete() < 0)
+		return -1;
+
+#if !CLICK_STATS
+	return errh->error("Click was built without statistics, "
+			   "set LIBCLICK_STATS to 1 or 2");
+#endif
+	if (_nthreads < 1)
+		return errh->error("THREADS must be at least 1");
+	if (_apply && _nthreads > master()->nthreads())
+		return errh->error("cannot APPLY a plan for %d threads with %d router threads",
+				   _nthreads, master()->nthreads());
+	if (_burst < 1)
+		return errh->error("BURST must be at least 1");
+	return 0;
+}
+
+int
+ThreadPlanner::initialize(ErrorHandler *)
+{
+	_timer.initialize(this);
+	write_handler(String(), this, 0, 0);
+	return 0;
+}
+
+uint64_t
+ThreadPlanner::element_cost(Element *e)
+{
+#if CLICK_STATS >= 2
+	uint64_t calls, cycles;
+
+	CycleProfiler::read_cycles(e, true, calls, cycles);
+	return cycles;
+#else
+	return CycleProfiler::read_counts(e, e->ninputs() ? "icounts" : "ocounts");
+#endif
+}
+
+void
+ThreadPlanner::snapshot(Vector<uint64_t> &cost)
+{
+	cost.resize(router()->nelements());
+	for (int i = 0; i < cost.size(); ++i)
+		cost[i] = element_cost(router()->element(i));
+}
+
+/* Idle tasks are unscheduled, so look at the task lists repeatedly */
+void
+ThreadPlanner::collect_tasks()
+{
+	for (int i = 0; i < master()->nthreads(); ++i) {
+		Vector<Task *> tasks;
+
+		master()->thread(i)->scheduled_tasks(router(), tasks);
+		for (int j = 0; j < tasks.size(); ++j) {
+			int k = 0;
+
+			while (k < _tasks.size() && _tasks[k] != tasks[j])
+				++k;
+			if (k == _tasks.size())
+				_tasks.push_back(tasks[j]);
+		}
+	}
+}
+
+void
+ThreadPlanner::run_timer(Timer *)
+{
+	collect_tasks();
+	if (Timestamp::now() < _end) {
+		_timer.reschedule_after_msec(10);
+		return;
+	}
+
+	/* the running router cannot be cut, so apply the plan without cuts */
+	plan(false);
+	for (int u = 0; _apply && u < _units.size(); ++u) {
+		Task *t = _units[u].task;
+
+		if (t->home_thread_id() != _units[u].thread)
+			t->move_thread(_units[u].thread);
+	}
+	if (_split)
+		plan(true);
+	_planned = true;
+	click_chatter("%p{element}: planned %d tasks and %d cuts on %d threads%s",
+		      this, _tasks.size(), _units.size() - _tasks.size(),
+		      _nthreads, _apply ? ", tasks moved" : "");
+}
+
+/* Marks the elements a call into root runs: along push outputs and pull
+ * inputs, stopping at queues, which are pushed into and pulled from.
+ * Does not enter element block.
+ */
+void
+ThreadPlanner::reach(Element *root, Element *block, Vector<bool> &member) const
+{
+	Vector<Element *> queue;
+
+	member.assign(router()->nelements(), false);
+	member[root->eindex()] = true;
+	queue.push_back(root);
+	for (int q = 0; q < queue.size(); ++q) {
+		Element *e = queue[q];
+
+		for (int p = 0; p < e->noutputs() + e->ninputs(); ++p) {
+			bool out = p < e->noutputs();
+			int port = out ? p : p - e->noutputs();
+			Element *n;
+
+			if (out ? !e->output_is_push(port) : !e->input_is_pull(port))
+				continue;
+			n = out ? e->output(port).element() : e->input(port).element();
+			if (n && n != block && !member[n->eindex()]) {
+				member[n->eindex()] = true;
+				queue.push_back(n);
+			}
+		}
+	}
+}
+
+/* Elements run by several tasks are shared out evenly */
+uint64_t
+ThreadPlanner::unit_cost(const Unit &u, const Vector<int> &owners) const
+{
+	uint64_t cost = 0;
+
+	for (int i = 0; i < u.member.size(); ++i)
+		if (u.member[i] && owners[i])
+			cost += _cost[i] / owners[i];
+	return cost;
+}
+
+/* Looks for the push connection that halves the work of unit u and moves
+ * the work behind it into a new unit. The element after the cut must have
+ * no other input, and nothing behind it may be reachable around it.
+ */
+bool
+ThreadPlanner::split(int u, const Vector<int> &owners, const Vector<int> &fanin)
+{
+	Vector<bool> child, rest, best_child;
+	Element *best_from = 0;
+	int best_port = 0;
+	uint64_t cost = _units[u].cost, best_diff = cost, best_down = 0;
+
+	for (int i = 0; i < router()->nelements(); ++i) {
+		Element *a = router()->element(i);
+
+		if (!_units[u].member[i])
+			continue;
+		for (int p = 0; p < a->noutputs(); ++p) {
+			Element *b = a->output_is_push(p) ? a->output(p).element() : 0;
+			uint64_t down, diff;
+			bool overlap = false;
+
+			if (!b || b == _units[u].root || fanin[b->eindex()] != 1
+			    || !_units[u].member[b->eindex()])
+				continue;
+			reach(b, 0, child);
+			reach(_units[u].root, b, rest);
+			for (int j = 0; j < child.size(); ++j) {
+				child[j] = child[j] && _units[u].member[j];
+				overlap |= child[j] && rest[j];
+			}
+			if (overlap)
+				continue;
+
+			Unit probe;
+			probe.member = child;
+			down = unit_cost(probe, owners);
+			if (!down || down >= cost)
+				continue;
+			diff = 2 * down > cost ? 2 * down - cost : cost - 2 * down;
+			if (diff < best_diff) {
+				best_diff = diff;
+				best_down = down;
+				best_from = a;
+				best_port = p;
+				best_child = child;
+			}
+		}
+	}
+	if (!best_from)
+		return false;
+
+	Unit c;
+	c.cost = best_down;
+	c.task = 0;
+	c.root = best_from->output(best_port).element();
+	c.from = best_from;
+	c.from_port = best_port;
+	c.to_port = best_from->output(best_port).port();
+	c.thread = 0;
+	c.member = best_child;
+	for (int j = 0; j < c.member.size(); ++j)
+		if (c.member[j])
+			_units[u].member[j] = false;
+	_units[u].cost -= best_down;
+	_units.push_back(c);
+	return true;
+}
+
+static int
+unit_compar(const void *a, const void *b, void *)
+{
+	uint64_t x = *static_cast<const uint64_t *>(a);
+	uint64_t y = *static_cast<const uint64_t *>(b);
+
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+void
+ThreadPlanner::plan(bool cut)
+{
+	int n = router()->nelements();
+	Vector<int> owners(n, 0), fanin(n, 0);
+	uint64_t total = 0;
+	struct Order {
+		uint64_t cost;
+		int unit;
+	};
+	Vector<Order> order;
+
+	snapshot(_cost);
+	for (int i = 0; i < n; ++i)
+		_cost[i] = _cost[i] > _cost0[i] ? _cost[i] - _cost0[i] : 0;
+	for (int i = 0; i < n; ++i) {
+		Element *e = router()->element(i);
+
+		for (int p = 0; p < e->noutputs(); ++p)
+			if (e->output_is_push(p) && e->output(p).element())
+				fanin[e->output(p).element()->eindex()]++;
+	}
+
+	_units.clear();
+	for (int t = 0; t < _tasks.size(); ++t) {
+		Unit u;
+
+		u.task = _tasks[t];
+		u.root = _tasks[t]->element();
+		u.from = 0;
+		u.from_port = u.to_port = 0;
+		u.thread = u.task->home_thread_id();
+		reach(u.root, 0, u.member);
+		for (int i = 0; i < n; ++i)
+			owners[i] += u.member[i];
+		_units.push_back(u);
+	}
+	for (int u = 0; u < _units.size(); ++u) {
+		_units[u].cost = unit_cost(_units[u], owners);
+		total += _units[u].cost;
+	}
+
+	/* Cut the heaviest unit while it is over a thread's share by more
+	 * than a quarter and there are threads to spare
+	 */
+	while (cut && _units.size() < _nthreads) {
+		int m = 0;
+
+		for (int u = 1; u < _units.size(); ++u)
+			if (_units[u].cost > _units[m].cost)
+				m = u;
+		if (!total || _units[m].cost * _nthreads * 4 <= total * 5
+		    || !split(m, owners, fanin))
+			break;
+	}
+
+	/* Heaviest first onto the least loaded thread; on a tie, stay */
+	order.resize(_units.size());
+	for (int u = 0; u < _units.size(); ++u) {
+		order[u].cost = _units[u].cost;
+		order[u].unit = u;
+	}
+	click_qsort(order.begin(), order.size(), sizeof(Order), unit_compar, 0);
+	_load.assign(_nthreads, 0);
+	for (int i = 0; i < order.size(); ++i) {
+		Unit &u = _units[order[i].unit];
+		int best = u.task && u.thread < _nthreads ? u.thread : 0;
+
+		for (int t = 0; t < _nthreads; ++t)
+			if (_load[t] < _load[best])
+				best = t;
+		u.thread = best;
+		_load[best] += u.cost;
+	}
+}
+
+/* Flat connections look like "a [0] -> [1] b;"; accept the ports left
+ * out when zero, too
+ */
+static bool
+is_connection(const String &line, const String &from, int from_port,
+	      const String &to, int to_port)
+{
+	String f = from_port ? from + " [" + String(from_port) + "]" : from;
+	String t = to_port ? "[" + String(to_port) + "] " + to : to;
+
+	return line == f + " -> " + t + ";"
+		|| line == from + " [" + String(from_port) + "] -> ["
+			   + String(to_port) + "] " + to + ";";
+}
+
+String
+ThreadPlanner::unparse_config() const
+{
+	Element *root = router()->root_element();
+	const Handler *h = Router::handler(root, "flatconfig");
+	String flat = h ? h->call_read(root) : String();
+	String self = name() + " :: ";
+	StringAccum sa, sched;
+	Vector<bool> done(_units.size(), false);
+	bool skipping = false;
+	const char *s = flat.begin();
+
+	while (s < flat.end()) {
+		const char *eol = s;
+		String line, trimmed;
+		bool keep = true;
+
+		while (eol < flat.end() && *eol != '\n')
+			++eol;
+		line = flat.substring(s, eol);
+		trimmed = line.trim_space();
+		s = eol < flat.end() ? eol + 1 : eol;
+		/* our own declaration and StaticThreadSched, which we replace */
+		if (skipping || trimmed.starts_with(self)
+		    || trimmed.find_left(":: StaticThreadSched(") >= 0) {
+			skipping = !trimmed.ends_with(";");
+			continue;
+		}
+		for (int u = 0; u < _units.size(); ++u) {
+			const Unit &c = _units[u];
+
+			if (c.task || done[u]
+			    || !is_connection(trimmed, c.from->name(), c.from_port,
+					      c.root->name(), c.to_port))
+				continue;
+			sa << c.from->name() << " [" << c.from_port << "] -> "
+			   << name() << "_q" << u << " :: SPSCQueue -> "
+			   << name() << "_uq" << u << " :: Unqueue(BURST "
+			   << _burst << ") -> [" << c.to_port << "] "
+			   << c.root->name() << ";\n";
+			done[u] = true;
+			keep = false;
+		}
+		if (keep)
+			sa << line << '\n';
+	}
+
+	for (int u = 0; u < _units.size(); ++u) {
+		const Unit &c = _units[u];
+
+		if (!c.task && !done[u])
+			sa << "// could not cut " << c.from->name() << " ["
+			   << c.from_port << "] -> [" << c.to_port << "] "
+			   << c.root->name() << "\n";
+		sched << (sched.length() ? ", " : "");
+		if (c.task)
+			sched << c.task->element()->name();
+		else
+			sched << name() << "_uq" << u;
+		sched << ' ' << c.thread;
+	}
+	if (sched.length())
+		sa << name() << "_sched :: StaticThreadSched(" << sched << ");\n";
+	return sa.take_string();
+}
+
+String
+ThreadPlanner::read_handler(Element *e, void *thunk)
+{
+	ThreadPlanner *tp = static_cast<ThreadPlanner *>(e);
+	StringAccum sa;
+	uint64_t total = 0;
+
+	if (!tp->_planned)
+		return "calibrating\n";
+	if (thunk)
+		return tp->unparse_config();
+
+	for (int t = 0; t < tp->_load.size(); ++t)
+		total += tp->_load[t];
+	for (int t = 0; t < tp->_load.size(); ++t) {
+		unsigned permille = total ? tp->_load[t] * 1000 / total : 0;
+		sa.snprintf(64, "thread %d: %4u.%u%%\n", t, permille / 10,
+			    permille % 10);
+	}
+	for (int u = 0; u < tp->_units.size(); ++u) {
+		const Unit &c = tp->_units[u];
+		unsigned permille = total ? c.cost * 1000 / total : 0;
+		StringAccum what;
+
+		if (c.task)
+			what << "task " << c.task->element()->name();
+		else
+			what << "cut " << c.from->name() << " [" << c.from_port
+			     << "] -> [" << c.to_port << "] " << c.root->name();
+		sa.snprintf(160, "%-40s %16llu %4u.%u%% thread %d\n",
+			    what.c_str(), (unsigned long long) c.cost,
+			    permille / 10, permille % 10, c.thread);
+	}
+	return sa.take_string();
+}
+
+int
+ThreadPlanner::write_handler(const String &s, Element *e, void *,
+			     ErrorHandler *errh)
+{
+	ThreadPlanner *tp = static_cast<ThreadPlanner *>(e);
+	Timestamp len = tp->_calibrate;
+
+	if (s && !TimestampArg().parse(cp_uncomment(s), len))
+		return errh->error("expected time");
+	tp->_planned = false;
+	tp->_tasks.clear();
+	tp->snapshot(tp->_cost0);
+	tp->_end = Timestamp::now() + len;
+	tp->_timer.schedule_now();
+	return 0;
+}
+
+void
+ThreadPlanner::add_handlers()
+{
+	add_read_handler("plan", read_handler, 0);
+	add_read_handler("config", read_handler, 1);
+	add_write_handler("calibrate", write_handler, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(CycleProfiler)
+EXPORT_ELEMENT(ThreadPlanner)
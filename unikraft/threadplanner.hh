@@ -0,0 +1,183 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2026, NEC Laboratories Europe GmbH, NEC Corporation.
+ *               All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLICK_THREADPLANNER_HH
+#define CLICK_THREADPLANNER_HH
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/*
+=c
+
+ThreadPlanner([I<keywords> THREADS, CALIBRATE, APPLY, SPLIT, BURST])
+
+=s threads
+
+assigns tasks to router threads from measured costs
+
+=d
+
+Measures what every task of the router costs during a short calibration
+run, then spreads the tasks over the router threads so that the threads
+carry about the same load.
+
+The cost of an element is its exclusive cycles when Click is built with
+LIBCLICK_STATS set to 2, or the packets through it with LIBCLICK_STATS set
+to 1. A task is charged for every element it runs: the elements reached
+from the task's element along push outputs and pull inputs, that is,
+everything up to the next queue. Elements reached by several tasks are
+shared out evenly. Tasks are then placed heaviest first on the least
+loaded thread.
+
+When there are more threads than tasks and a task costs more than a
+thread's share, the planner also looks for a push connection that cuts
+the task's work about in half. Moving the downstream half to another
+thread needs a handoff queue on that connection. Queues cannot be added
+to a running router, so the tasks are moved as planned without cuts, and
+cuts only show in the C<plan> and C<config> handlers. C<config> returns
+the flattened configuration with SPSCQueue -> Unqueue pairs inserted on
+the cuts, and one StaticThreadSched holding the whole assignment in place
+of any StaticThreadSched of the original.
+
+Keyword arguments are:
+
+=over 8
+
+=item THREADS
+
+Integer. Threads to plan for. Default is the number of router threads.
+
+=item CALIBRATE
+
+Time. Length of the calibration run, which starts when the router does.
+Default is 1 second.
+
+=item APPLY
+
+Boolean. Move the tasks to their planned threads when calibration ends.
+Only possible if THREADS is not more than the number of router threads.
+Default is true.
+
+=item SPLIT
+
+Boolean. Look for connections to cut. Default is true.
+
+=item BURST
+
+Integer. BURST of the Unqueue elements in the C<config> handler. Default
+is 32.
+
+=back
+
+=h plan read-only
+
+Returns the plan, with cuts if SPLIT is true: the load of each thread, then
+one line per task and per cut with its cost and thread.
+
+=h config read-only
+
+Returns the planned configuration, ready to boot.
+
+=h calibrate write-only
+
+Starts another calibration run, of the given length or CALIBRATE.
+
+=a StaticThreadSched, CycleProfiler, SPSCQueue, Unqueue
+*/
+
+class ThreadPlanner : public Element { public:
+
+    ThreadPlanner();
+    ~ThreadPlanner();
+
+    const char *class_name() const	{ return "ThreadPlanner"; }
+    const char *port_count() const	{ return PORTS_0_0; }
+    int configure_phase() const		{ return CONFIGURE_PHASE_LAST; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void add_handlers();
+
+    void run_timer(Timer *);
+
+  private:
+
+    /* Work run by one thread: a task, or the part of a task's work
+     * behind a cut, which becomes an Unqueue task
+     */
+    struct Unit {
+	uint64_t cost;		// first: sort key
+	Task *task;		// 0 for cuts
+	Element *root;		// task element, or element after the cut
+	Element *from;		// cut: upstream end
+	int from_port;
+	int to_port;
+	int thread;
+	Vector<bool> member;
+    };
+
+    int _nthreads;
+    Timestamp _calibrate;
+    bool _apply;
+    bool _split;
+    int _burst;
+
+    Timer _timer;
+    Timestamp _end;
+    bool _planned;
+    Vector<Task *> _tasks;
+    Vector<uint64_t> _cost0;
+    Vector<uint64_t> _cost;
+    Vector<Unit> _units;
+    Vector<uint64_t> _load;
+
+    static uint64_t element_cost(Element *);
+    void snapshot(Vector<uint64_t> &);
+    void collect_tasks();
+    void plan(bool cut);
+    void reach(Element *root, Element *block, Vector<bool> &member) const;
+    uint64_t unit_cost(const Unit &, const Vector<int> &owners) const;
+    bool split(int u, const Vector<int> &owners, const Vector<int> &fanin);
+    String unparse_config() const;
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -29,13 +29,28 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if CONFIG_LIBCLICK_TRACE
+#define UK_DEBUG_TRACE
+#endif
 #include "todevice.hh"
 
 #include <click/args.hh>
+#include <click/confparse.hh>
 #include <click/error.hh>
+#include <click/handler.hh>
 #include <click/router.hh>
 #include <click/standard/scheduleinfo.hh>
+#include <click/straccum.hh>
 #include <click/task.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+#include <click_alloc.h>
+#include <click_cksum.h>
+#include <click_netdev.h>
+#include <stddef.h>
 #include <stdio.h>
 
 #ifdef xmit
@@ -47,75 +62,746 @@
 
 #include <uk/alloc.h>
 #include <uk/netdev.h>
+#include <uk/trace.h>
+
+UK_TRACEPOINT(trace_click_tx, "elem=%u pkt=%lx len=%u",
+	      unsigned, unsigned long, unsigned);
+UK_TRACEPOINT(trace_click_tx_busy, "elem=%u spins=%u", unsigned, unsigned);
 
 CLICK_DECLS
 
 ToDevice::ToDevice()
-	: _task(this)
+	: _task(this), _nd(0)
 {
+	_stage_drops = 0;
+	_tx_errors = 0;
 }
 
 ToDevice::~ToDevice()
 {
 }
 
+/* Parses a space-separated list of positive integers into one value per
+ * input, the last one repeating.
+ */
+static int
+parse_per_input(const String &str, uint32_t dflt, int n, Vector<uint32_t> &v)
+{
+	Vector<String> words;
+	uint32_t x = dflt;
+
+	cp_spacevec(str, words);
+	v.resize(n);
+	for (int i = 0; i < n; ++i) {
+		if (i < words.size() && (!IntArg().parse(words[i], x) || !x))
+			return -1;
+		v[i] = x;
+	}
+	return 0;
+}
+
 int
 ToDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+	bool tso = true;
+	String queue_map, quantum, capacity;
+	Vector<String> words;
+	int nthreads = master()->nthreads();
+
 	_devid = 0;
+	_bufsize = 0;
+	_gso_anno = -1;
+	_trace = false;
+	_stage_capacity = CONFIG_LIBCLICK_TX_STAGE;
+	_nprio = ninputs();
 
 	uk_pr_info("ToDevice::configure %p\n", this);
 	if (Args(conf, this, errh)
 			.read_p("DEVID", IntArg(), _devid)
+			.read("BUFSIZE", _bufsize)
+			.read("GSO_ANNO", AnnoArg(2), _gso_anno)
+			.read("TSO", tso)
+			.read("QUEUE_MAP", AnyArg(), queue_map)
+			.read("STAGE_CAPACITY", _stage_capacity)
+			.read("PRIORITY", _nprio)
+			.read("QUANTUM", AnyArg(), quantum)
+			.read("CAPACITY", AnyArg(), capacity)
+			.read("TRACE", _trace)
 			.complete() < 0)
 		return -1;
 
-	if (_devid < 0)
-		return errh->error("Device ID must be >= 0");
+	if (_bufsize && _bufsize < 64)
+		return errh->error("BUFSIZE must be 0 or at least 64");
 
-	_dev = uk_netdev_get((unsigned int) _devid);
-	if (!_dev)
-		return errh->error("No such device %d", _devid);
-	uk_netdev_info_get(_dev, &_dev_info);
+	if (!(_nd = NetDev::get(_devid, errh)))
+		return -1;
+	_dev = _nd->dev;
+	_dev_info = _nd->info;
+	_hw_tso = tso && _nd->tso;
+
+	_ntxq = _nd->ntxq;
+	if (_stage_capacity < 1 || _stage_capacity > (1U << 20))
+		return errh->error("STAGE_CAPACITY must be between 1 and 2^20");
+	if (_nprio < 0 || _nprio > ninputs())
+		return errh->error("PRIORITY must be between 0 and the number of inputs");
+	if (parse_per_input(quantum, 1514, ninputs(), _quantum) < 0)
+		return errh->error("QUANTUM must be a list of positive integers");
+	if (parse_per_input(capacity, _stage_capacity, ninputs(), _capacity) < 0)
+		return errh->error("CAPACITY must be a list of positive integers");
+	for (int i = 0; i < ninputs(); ++i)
+		if (_capacity[i] > (1U << 20))
+			return errh->error("CAPACITY must be at most 2^20");
+	cp_spacevec(queue_map, words);
+	_txq_map.resize(nthreads);
+	for (int t = 0; t < nthreads; ++t) {
+		int q = t % _ntxq;
+		if (words.size()
+		    && (!IntArg().parse(words[t % words.size()], q)
+			|| q < 0 || q >= _ntxq))
+			return errh->error("QUEUE_MAP entries must be TX queues of device %d (0 to %u)",
+					   _devid, _ntxq - 1);
+		_txq_map[t] = q;
+	}
 
 	return 0;
 }
 
 int
-ToDevice::initialize(ErrorHandler *errh __unused)
+ToDevice::initialize(ErrorHandler *errh)
 {
-	/* uk netdev is initialized in the corresponding FromDevice */
+	/* the device may have no FromDevice, so whoever comes first starts
+	 * it; here we also set up staging for TX queues shared by several
+	 * threads, and with several inputs the class queues of every TX
+	 * queue in use.
+	 */
+	bool classes = ninputs() > 1;
+
+	if (BatchElement::initialize(errh) < 0 || _nd->start(errh) < 0)
+		return -1;
+	_stages.assign(_ntxq, 0);
+	for (int t = 0; t < _txq_map.size(); ++t) {
+		int q = _txq_map[t];
+		int first = 0;
+
+		while (_txq_map[first] != q)
+			++first;
+		if (first != t)
+			uk_pr_info("ToDevice %d: TX queue %u shared, thread %d drains\n",
+				   _devid, q, first);
+		else {
+			/* only the first thread on a queue sends on it */
+			if (_nd->attach_tx(q, first, errh) < 0)
+				return -1;
+			_txqs.push_back(q);
+		}
+		if (_stages[q] || (first == t && !classes))
+			continue;
+
+		TxStage *st = new TxStage;
+		if (!st || (classes ? init_classes(st)
+			    : st->ring.initialize(_stage_capacity)) < 0) {
+			delete[] (st ? st->classes : 0);
+			delete st;
+			return errh->error("out of memory");
+		}
+		st->owner = this;
+		st->thread = first;
+		st->queue = q;
+		st->task = new Task(drain_task, st);
+		st->task->initialize(this, false);
+		st->task->move_thread(first);
+		_stages[q] = st;
+	}
 	return 0;
 }
 
+int
+ToDevice::init_classes(TxStage *st)
+{
+	if (!(st->classes = new TxClass[ninputs()]))
+		return -1;
+	for (int c = 0; c < ninputs(); ++c) {
+		TxClass &k = st->classes[c];
+
+		if (k.ring.initialize(_capacity[c]) < 0)
+			return -1;
+		k.head = 0;
+		k.quantum = c < _nprio ? 0 : _quantum[c];
+		k.deficit = 0;
+		k.sent = k.bytes = 0;
+		k.drops = 0;
+	}
+	/* the first DRR class starts with its turn */
+	if (_nprio < ninputs()) {
+		st->drr = _nprio;
+		st->classes[_nprio].deficit = st->classes[_nprio].quantum;
+	}
+	return 0;
+}
+
+String
+ToDevice::read_handler(Element *e, void *thunk)
+{
+	ToDevice *td = static_cast<ToDevice *>(e);
+	StringAccum sa;
+	intptr_t what = reinterpret_cast<intptr_t>(thunk);
+
+	if (what == 0) {
+		for (int t = 0; t < td->_txq_map.size(); ++t)
+			sa << (t ? " " : "") << td->_txq_map[t];
+		return sa.take_string();
+	}
+	if (what == 1)
+		return String(td->_stage_drops.value());
+	if (what == 6)
+		return String(td->_tx_errors.value());
+
+	/* per input, summed over TX queues */
+	for (int c = 0; c < td->ninputs(); ++c) {
+		uint64_t v = 0;
+
+		for (int q = 0; q < td->_stages.size(); ++q) {
+			TxStage *st = td->_stages[q];
+			if (!st || !st->classes)
+				continue;
+			TxClass &k = st->classes[c];
+			if (what == 2)
+				v += k.sent;
+			else if (what == 3)
+				v += k.bytes;
+			else if (what == 4)
+				v += k.drops.value();
+			else
+				v += k.ring.size() + (k.head ? 1 : 0);
+		}
+		sa << (c ? " " : "") << v;
+	}
+	return sa.take_string();
+}
+
+void
+ToDevice::add_handlers()
+{
+	add_read_handler("queue_map", read_handler, 0);
+	add_read_handler("stage_drops", read_handler, 1);
+	add_read_handler("tx_errors", read_handler, 6);
+	add_read_handler("sent", read_handler, 2);
+	add_read_handler("bytes", read_handler, 3);
+	add_read_handler("drops", read_handler, 4);
+	add_read_handler("length", read_handler, 5);
+	add_data_handlers("trace", Handler::f_read | Handler::f_write | Handler::f_checkbox, &_trace);
+}
+
 void
 ToDevice::cleanup(CleanupStage stage __unused)
 {
-	/* any potentially necessary uk netdev cleanup is done in the
-	 * corresponding FromDevice
-	 */
+	struct uk_netbuf *buf;
+
+	/* the device stays up for later routers (see NetDev) */
+	for (int q = 0; q < _stages.size(); ++q)
+		if (TxStage *st = _stages[q]) {
+			while (st->ring.dequeue(buf))
+				uk_netbuf_free(buf);
+			for (int c = 0; st->classes && c < ninputs(); ++c) {
+				TxClass &k = st->classes[c];
+				if (k.head)
+					uk_netbuf_free(k.head);
+				while (k.ring.dequeue(buf))
+					uk_netbuf_free(buf);
+			}
+			delete[] st->classes;
+			delete st->task;
+			delete st;
+		}
+	_stages.clear();
+	for (int i = 0; i < _txqs.size(); ++i)
+		_nd->detach_tx(_txqs[i]);
+	_txqs.clear();
 }
 
+/* Copies p into one netbuf, or into a chain of netbufs of at most
+ * _bufsize bytes each.
+ */
+struct uk_netbuf *
+ToDevice::packet_to_netbuf(Packet *p)
+{
+	struct uk_netbuf *head = NULL, *nb;
+	const unsigned char *d = p->data();
+	uint32_t left = p->length(), seg;
+	uint16_t headroom = _dev_info.nb_encap_tx;
+
+	do {
+		seg = (_bufsize && left > _bufsize) ? _bufsize : left;
+		nb = uk_netbuf_alloc_buf(uk_alloc_get_default(),
+				seg + headroom, _dev_info.ioalign,
+				headroom, 0, CLICK_MEM_NETBUF_DTOR);
+		if (!nb) {
+			if (head)
+				uk_netbuf_free(head);
+			return NULL;
+		}
+		click_mem_netbuf_alloc(nb);
+		memcpy(nb->data, d, seg);
+		nb->len = seg;
+		if (head)
+			uk_netbuf_append(head, nb);
+		else
+			head = nb;
+		/* only the first segment carries the device header */
+		headroom = 0;
+		d += seg;
+		left -= seg;
+	} while (left);
+	return head;
+}
+
+/* Returns false if the device failed; buf is freed then */
+bool
+ToDevice::transmit(uint16_t queue, struct uk_netbuf *buf)
+{
+	unsigned spins = 0;
+	int ret;
+
+	while (1) {
+		ret = uk_netdev_tx_one(_dev, queue, buf);
+		if (!uk_netdev_status_notready(ret))
+			break;
+		++spins;
+	}
+	if (unlikely(_trace && spins))
+		trace_click_tx_busy(eindex(), spins);
+	if (unlikely(ret < 0)) {
+		_tx_errors++;
+		uk_netbuf_free(buf);
+		return false;
+	}
+	return true;
+}
+
+/* Hands n buffers to the device in as few calls as its TX ring allows */
 void
-ToDevice::push(int port, Packet *p)
+ToDevice::transmit_burst(uint16_t queue, struct uk_netbuf **bufs, uint16_t n)
 {
+	unsigned spins = 0;
+	uint16_t cnt;
 	int ret;
+
+	while (n) {
+		cnt = n;
+		ret = uk_netdev_tx_burst(_dev, queue, bufs, &cnt);
+		if (unlikely(ret < 0)) {
+			uk_pr_err("ToDevice %d: transmit failed: %d\n", _devid, ret);
+			_tx_errors += n - cnt;
+			for (uint16_t i = cnt; i < n; ++i)
+				uk_netbuf_free(bufs[i]);
+			break;
+		}
+		bufs += cnt;
+		n -= cnt;
+		if (n)
+			++spins;
+	}
+	if (unlikely(_trace && spins))
+		trace_click_tx_busy(eindex(), spins);
+}
+
+void
+ToDevice::flush(TxBurst *burst)
+{
+	if (burst->n)
+		transmit_burst(burst->queue, burst->bufs, burst->n);
+	burst->n = 0;
+}
+
+/* Runs on the thread owning the shared queue only. Takes at most one
+ * ring's worth so producers cannot keep it here forever.
+ */
+void
+ToDevice::drain(TxStage *st)
+{
+	struct uk_netbuf *bufs[TX_BURST];
+	uint32_t n, budget = st->ring.capacity();
+
+	while (budget && (n = st->ring.dequeue_burst(bufs, budget < TX_BURST ? budget : TX_BURST))) {
+		transmit_burst(st->queue, bufs, n);
+		budget -= n;
+	}
+}
+
+bool
+ToDevice::drain_task(Task *task, void *thunk)
+{
+	TxStage *st = static_cast<TxStage *>(thunk);
+
+	if (st->classes) {
+		if (st->owner->schedule(st))
+			task->fast_reschedule();
+		return true;
+	}
+	st->owner->drain(st);
+	if (!st->ring.empty())
+		task->fast_reschedule();
+	return true;
+}
+
+/* Returns the class to send from next: the first strict-priority class
+ * with packets, else the DRR class whose turn it is once its deficit
+ * covers its next packet. Returns 0 if there is nothing to send.
+ */
+ToDevice::TxClass *
+ToDevice::pick(TxStage *st)
+{
+	int n = ninputs(), idle = 0;
+
+	for (int c = 0; c < _nprio; ++c) {
+		TxClass &k = st->classes[c];
+		if (k.head || k.ring.dequeue(k.head))
+			return &k;
+	}
+	if (_nprio == n)
+		return 0;
+	while (1) {
+		TxClass &k = st->classes[st->drr];
+
+		if (k.head || k.ring.dequeue(k.head)) {
+			if (k.deficit >= uk_netbuf_len(k.head))
+				return &k;
+			idle = 0;
+		} else {
+			k.deficit = 0;
+			if (++idle == n - _nprio)
+				return 0;
+		}
+		if (++st->drr == n)
+			st->drr = _nprio;
+		st->classes[st->drr].deficit += st->classes[st->drr].quantum;
+	}
+}
+
+/* Runs on the thread owning the TX queue only. Hands queued buffers to
+ * the device until it is full or they run out; returns true in the first
+ * case.
+ */
+bool
+ToDevice::schedule(TxStage *st)
+{
+	TxClass *k;
+	uint32_t len;
+	int ret;
+
+	while ((k = pick(st))) {
+		len = uk_netbuf_len(k->head);
+		ret = uk_netdev_tx_one(_dev, st->queue, k->head);
+		if (unlikely(ret < 0)) {
+			_tx_errors++;
+			uk_netbuf_free(k->head);
+			k->head = 0;
+			continue;
+		}
+		if (uk_netdev_status_notready(ret)) {
+			if (unlikely(_trace))
+				trace_click_tx_busy(eindex(), 1);
+			return true;
+		}
+		k->head = 0;
+		if (k->quantum)
+			k->deficit -= len;
+		k->sent++;
+		k->bytes += len;
+	}
+	return false;
+}
+
+/* Queues buf in class port of the TX queue; the owner of the queue sends
+ * right away, others leave that to its task. Returns false if the class
+ * queue is full; buf is freed then.
+ */
+bool
+ToDevice::enqueue(TxStage *st, int port, struct uk_netbuf *buf, int thread)
+{
+	TxClass &k = st->classes[port];
+
+	if (unlikely(!k.ring.enqueue(buf))) {
+		k.drops++;
+		uk_netbuf_free(buf);
+		return false;
+	}
+	if (thread != st->thread || schedule(st))
+		st->task->reschedule();
+	return true;
+}
+
+/* Sends buf on the calling thread's TX queue. Threads that share a queue
+ * with its owner stage the buffer for the owner instead. With several
+ * inputs, buf goes through the queue of its input's class. Given a burst,
+ * buffers for the device are gathered there until it is full or flushed.
+ * Returns false if buf was dropped, and freed, on the way.
+ */
+bool
+ToDevice::send_netbuf(int port, struct uk_netbuf *buf, TxBurst *burst)
+{
+	int t = click_current_cpu_id();
+	uint16_t q;
+	TxStage *st;
+
+	if (unlikely(t >= _txq_map.size()))
+		t = 0;
+	q = _txq_map[t];
+	st = _stages[q];
+	if (st && st->classes)
+		return enqueue(st, port, buf, t);
+	if (st) {
+		if (t != st->thread) {
+			if (unlikely(!st->ring.enqueue(buf))) {
+				_stage_drops++;
+				uk_netbuf_free(buf);
+				return false;
+			}
+			st->task->reschedule();
+			return true;
+		}
+		if (!st->ring.empty())
+			drain(st);
+	}
+	if (burst) {
+		burst->queue = q;
+		burst->bufs[burst->n++] = buf;
+		if (burst->n == TX_BURST)
+			flush(burst);
+		return true;
+	}
+	return transmit(q, buf);
+}
+
+/* Header layout of a packet to be segmented, as offsets from the start of
+ * the Ethernet header.
+ */
+struct gso_hdr {
+	uint32_t l3;
+	uint32_t l4;
+	uint32_t hlen;
+	uint8_t proto;
+	bool v6;
+};
+
+static bool
+gso_parse(const unsigned char *d, uint32_t len, gso_hdr &g)
+{
+	uint16_t type;
+
+	g.l3 = sizeof(click_ether);
+	if (len < g.l3)
+		return false;
+	type = reinterpret_cast<const click_ether *>(d)->ether_type;
+	if (type == htons(ETHERTYPE_8021Q)) {
+		if (len < g.l3 + 4)
+			return false;
+		type = *reinterpret_cast<const uint16_t *>(d + g.l3 + 2);
+		g.l3 += 4;
+	}
+
+	if (type == htons(ETHERTYPE_IP)) {
+		const click_ip *iph = reinterpret_cast<const click_ip *>(d + g.l3);
+		if (len < g.l3 + sizeof(click_ip) || iph->ip_hl < 5
+		    || (iph->ip_off & htons(IP_MF | IP_OFFMASK)))
+			return false;
+		g.l4 = g.l3 + (iph->ip_hl << 2);
+		g.proto = iph->ip_p;
+		g.v6 = false;
+	} else if (type == htons(ETHERTYPE_IP6)) {
+		const click_ip6 *ip6 = reinterpret_cast<const click_ip6 *>(d + g.l3);
+		if (len < g.l3 + sizeof(click_ip6))
+			return false;
+		g.l4 = g.l3 + sizeof(click_ip6);
+		g.proto = ip6->ip6_nxt;
+		g.v6 = true;
+	} else
+		return false;
+
+	if (g.proto == IP_PROTO_TCP) {
+		const click_tcp *th = reinterpret_cast<const click_tcp *>(d + g.l4);
+		if (len < g.l4 + sizeof(click_tcp) || th->th_off < 5)
+			return false;
+		g.hlen = g.l4 + (th->th_off << 2);
+	} else if (g.proto == IP_PROTO_UDP)
+		g.hlen = g.l4 + sizeof(click_udp);
+	else
+		return false;
+	return g.hlen <= len;
+}
+
+/* Turns the copied headers at h into those of the segment carrying seg
+ * payload bytes starting at payload offset off.
+ */
+static void
+gso_fixup(unsigned char *h, const gso_hdr &g, uint32_t off, uint32_t seg,
+	  bool last, uint32_t seq, uint16_t id)
+{
+	uint32_t l4len = g.hlen - g.l4 + seg;
+
+	if (g.v6) {
+		click_ip6 *ip6 = reinterpret_cast<click_ip6 *>(h + g.l3);
+		ip6->ip6_plen = htons(l4len);
+	} else {
+		click_ip *iph = reinterpret_cast<click_ip *>(h + g.l3);
+		uint16_t old_len = iph->ip_len, old_id = iph->ip_id;
+
+		iph->ip_len = htons(g.l4 - g.l3 + l4len);
+		iph->ip_id = htons(id);
+		iph->ip_sum = click_cksum_adjust16(iph->ip_sum, old_len, iph->ip_len);
+		iph->ip_sum = click_cksum_adjust16(iph->ip_sum, old_id, iph->ip_id);
+	}
+
+	if (g.proto == IP_PROTO_TCP) {
+		click_tcp *th = reinterpret_cast<click_tcp *>(h + g.l4);
+
+		th->th_seq = htonl(seq + off);
+		if (!last)
+			th->th_flags &= ~(TH_FIN | TH_PUSH);
+		if (off)
+			th->th_flags &= ~TH_CWR;
+		th->th_sum = 0;
+		th->th_sum = ~click_cksum_partial(h + g.l4, l4len,
+				click_cksum_pseudo(h + g.l3, g.v6, g.proto, l4len));
+	} else {
+		click_udp *uh = reinterpret_cast<click_udp *>(h + g.l4);
+
+		uh->uh_ulen = htons(l4len);
+		/* a zero IPv4 UDP checksum means none */
+		if (g.v6 || uh->uh_sum) {
+			uh->uh_sum = 0;
+			uh->uh_sum = ~click_cksum_partial(h + g.l4, l4len,
+					click_cksum_pseudo(h + g.l3, g.v6, g.proto, l4len));
+			if (!uh->uh_sum)
+				uh->uh_sum = 0xFFFF;
+		}
+	}
+}
+
+/* Sends p as segments of at most mss payload bytes. Returns -1, without
+ * sending anything, if p is not a TCP or UDP packet that needs it, and -2
+ * if segments were lost; those before the loss may have been sent.
+ */
+int
+ToDevice::send_gso(int port, Packet *p, uint16_t mss, TxBurst *burst)
+{
+	const unsigned char *d = p->data();
+	uint16_t headroom = _dev_info.nb_encap_tx;
+	uint32_t payload, off, seg, seq = 0;
+	uint16_t id = 0;
+	struct uk_netbuf *nb;
+	bool lost = false;
+	gso_hdr g;
+
+	if (!gso_parse(d, p->length(), g))
+		return -1;
+	payload = p->length() - g.hlen;
+	if (payload <= mss)
+		return -1;
+
+#ifdef UK_NETDEV_F_TSO4
+	if (_hw_tso && g.proto == IP_PROTO_TCP && !g.v6) {
+		click_tcp *th;
+
+		if (!(nb = packet_to_netbuf(p)))
+			goto nomem;
+		/* The device fills in lengths and checksums; it expects the
+		 * pseudo header sum without length in the TCP checksum.
+		 */
+		th = reinterpret_cast<click_tcp *>((unsigned char *) nb->data + g.l4);
+		th->th_sum = click_cksum_pseudo((unsigned char *) nb->data + g.l3,
+						g.v6, g.proto, 0);
+		nb->flags |= UK_NETBUF_F_PARTIAL_CSUM | UK_NETBUF_F_GSO_TCPV4;
+		nb->csum_start = g.l4;
+		nb->csum_offset = offsetof(click_tcp, th_sum);
+		nb->header_len = g.hlen;
+		nb->gso_size = mss;
+		return send_netbuf(port, nb, burst) ? 0 : -2;
+	}
+#endif
+
+	if (g.proto == IP_PROTO_TCP)
+		seq = ntohl(reinterpret_cast<const click_tcp *>(d + g.l4)->th_seq);
+	if (!g.v6)
+		id = ntohs(reinterpret_cast<const click_ip *>(d + g.l3)->ip_id);
+
+	for (off = 0; off < payload; off += seg, ++id) {
+		seg = payload - off < mss ? payload - off : mss;
+		nb = uk_netbuf_alloc_buf(uk_alloc_get_default(),
+				g.hlen + seg + headroom, _dev_info.ioalign,
+				headroom, 0, CLICK_MEM_NETBUF_DTOR);
+		if (!nb)
+			goto nomem;
+		click_mem_netbuf_alloc(nb);
+		memcpy(nb->data, d, g.hlen);
+		memcpy((unsigned char *) nb->data + g.hlen, d + g.hlen + off, seg);
+		nb->len = g.hlen + seg;
+		gso_fixup((unsigned char *) nb->data, g, off, seg,
+			  off + seg == payload, seq, id);
+		if (!send_netbuf(port, nb, burst))
+			lost = true;
+	}
+	return lost ? -2 : 0;
+
+nomem:
+	uk_pr_crit("Failed to allocate netbuf for sending");
+	_tx_errors++;
+	return -2;
+}
+
+/* Sends p; returns false if p could not be sent and was killed */
+bool
+ToDevice::send_packet(int port, Packet *p, TxBurst *burst)
+{
 	struct uk_netbuf *buf;
 
-	uk_pr_debug("push() packet %p (len %u) -> %d\n", p, p->length(), port);
-	buf = uk_netbuf_alloc_buf(uk_alloc_get_default(),
-			p->length()+_dev_info.nb_encap_rx, _dev_info.ioalign,
-			_dev_info.nb_encap_rx, 0, NULL);
+	uk_pr_debug("send packet %p (len %u)\n", p, p->length());
+	if (unlikely(_trace))
+		trace_click_tx(eindex(), (unsigned long) p, p->length());
+	if (unlikely(_gso_anno >= 0)) {
+		uint16_t mss = p->anno_u16(_gso_anno);
+		int ret = mss ? send_gso(port, p, mss, burst) : -1;
+		if (ret == 0)
+			return true;
+		if (ret < -1) {
+			p->kill();
+			return false;
+		}
+	}
+
+	buf = packet_to_netbuf(p);
 	if (!buf) {
 		uk_pr_crit("Failed to allocate netbuf for sending");
-		return;
+		_tx_errors++;
+		p->kill();
+		return false;
 	}
-	memcpy(buf->data, p->data(), p->length());
-	buf->len = p->length();
-	do {
-		ret = uk_netdev_tx_one(_dev, 0, buf);
-	} while (uk_netdev_status_notready(ret));
-	checked_output_push(port, p);
+	if (!send_netbuf(port, buf, burst)) {
+		p->kill();
+		return false;
+	}
+	return true;
+}
+
+void
+ToDevice::push(int port, Packet *p)
+{
+	if (send_packet(port, p))
+		checked_output_push(0, p);
+}
+
+void
+ToDevice::push_batch(int port, PacketBatch &batch)
+{
+	PacketBatch sent;
+	TxBurst burst;
+
+	burst.n = 0;
+	while (Packet *p = batch.pop_front())
+		if (send_packet(port, p, &burst))
+			sent.append(p);
+	flush(&burst);
+	checked_output_push_batch(0, sent);
 }
 
 bool
@@ -126,4 +812,5 @@ ToDevice::run_task(Task *)
 }
 
 CLICK_ENDDECLS
+ELEMENT_REQUIRES(BatchElement NetDevice)
 EXPORT_ELEMENT(ToDevice)
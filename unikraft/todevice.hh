@@ -33,9 +33,14 @@
 #define CLICK_TODEVICE_HH
 
 #include <click/config.h>
+#include <click/atomic.hh>
 #include <click/element.hh>
 #include <click/error.hh>
 #include <click/task.hh>
+#include <click/vector.hh>
+#include "batchelement.hh"
+#include "lfring.hh"
+#include "netdevice.hh"
 
 #include <uk/netdev.h>
 
@@ -45,27 +50,222 @@ extern "C" {
     struct uk_netdev;
 }
 
-class ToDevice : public Element {
+/*
+=c
+
+ToDevice(DEVID [, I<keywords> BUFSIZE, GSO_ANNO, TSO, QUEUE_MAP, STAGE_CAPACITY, PRIORITY, QUANTUM, CAPACITY, TRACE])
+
+=s netdevices
+
+sends packets to a Unikraft network device
+
+=d
+
+Sends pushed packets on network device DEVID, which is set up by a
+NetDevice element, or with its defaults if there is none. Sent packets are
+emitted on the optional output.
+
+With more than one input, each input is a traffic class with a queue of its
+own in front of every TX queue, and packets only leave these queues when the
+device has room for them. The first PRIORITY inputs are served in strict
+priority, input 0 first; the remaining ones share what is left by deficit
+round robin. Put control traffic such as ARP replies on input 0 to have it
+overtake bulk traffic waiting in ToDevice. It still waits for the frames
+already in the device's TX ring, which a small NetDevice TX_RING bounds.
+
+The device has one TX queue per router thread, or as many as it has or
+NetDevice's TX_QUEUES says, and every thread transmits on the queue it is mapped to without taking a lock.
+When a queue is shared by several threads, the first of them transmits on
+it directly and the others hand their buffers over through a lock-free
+staging ring, which a task on the first thread drains.
+Batches from batch-capable elements reach the device in bursts of up to
+32 buffers.
+
+Keyword arguments are:
+
+=over 8
+
+=item BUFSIZE
+
+Integer. Largest transmit buffer. Longer packets are sent as a chain of
+buffers of at most this size. Default is 0, meaning one buffer per packet.
+
+=item GSO_ANNO
+
+Annotation offset of a two-byte segment size. Ethernet frames carrying
+TCP or UDP over IPv4 or IPv6 whose payload exceeds a nonzero segment size
+are split into segments of at most that many payload bytes: TCP sequence
+numbers and flags are adjusted per segment, UDP payloads become separate
+datagrams. IPv4 headers are patched incrementally; transport checksums are
+recomputed. By default no annotation is looked at.
+
+=item TSO
+
+Boolean. Leave TCP over IPv4 segmentation to the device if it supports
+TCP segmentation offload and NetDevice's TSO allows it. Default is true.
+
+=item QUEUE_MAP
+
+Space-separated list of TX queue numbers: thread I transmits on the
+queue at position I, modulo the length of the list. Default is thread I
+on queue I modulo the number of queues.
+
+=item STAGE_CAPACITY
+
+Integer. Size of each staging ring of a shared queue. Packets arriving
+while it is full are dropped. Default is 256, or LIBCLICK_TX_STAGE.
+
+=item PRIORITY
+
+Integer. Number of inputs served in strict priority. Default is all
+inputs.
+
+=item QUANTUM
+
+Space-separated list of the bytes each of the other inputs may send per
+round, in input order; the last entry holds for the remaining inputs.
+Default is 1514.
+
+=item CAPACITY
+
+Space-separated list of queue depths in packets, one per input and TX
+queue, the last entry holding for the remaining inputs. Depths are rounded
+up to a power of two. Packets arriving while their queue is full are
+dropped. Default is STAGE_CAPACITY.
+
+=item TRACE
+
+Boolean. Record each packet handed to the device, and how often the device
+had no room for it, as Unikraft tracepoints (needs LIBCLICK_TRACE). Default
+is false.
+
+=back
+
+=h queue_map read-only
+
+Returns the TX queue of each thread.
+
+=h stage_drops read-only
+
+Returns the number of packets dropped because a staging ring was full.
+
+=h tx_errors read-only
+
+Returns the number of packets lost because the device failed to send them
+or no buffer could be allocated for them.
+
+=h sent read-only
+
+Returns the packets handed to the device per input, with more than one
+input.
+
+=h bytes read-only
+
+Returns the bytes handed to the device per input.
+
+=h drops read-only
+
+Returns the packets dropped per input because its queue was full.
+
+=h length read-only
+
+Returns the packets queued per input.
+
+=h trace read/write
+
+Whether tracing is on; can be changed at run time.
+
+=a NetDevice, FromDevice
+*/
+
+class ToDevice : public BatchElement {
 public:
     ToDevice();
     ~ToDevice();
 
     const char *class_name() const { return "ToDevice"; }
-    const char *port_count() const { return "1/0-1"; }
+    const char *port_count() const { return "1-/0-1"; }
     const char *processing() const { return "a/h"; }
-    int configure_phase() const { return CONFIGURE_PHASE_FIRST; }
+    int configure_phase() const { return CONFIGURE_PHASE_FIRST + 1; }
 
     int configure(Vector<String> &, ErrorHandler *);
     int initialize(ErrorHandler *);
     void cleanup(CleanupStage);
+    void add_handlers();
 
     bool run_task(Task *);
     void push(int, Packet *p);
+    void push_batch(int, PacketBatch &);
 
 private:
+    enum { TX_BURST = 32 };
+
+    /* Buffers gathered for one uk_netdev_tx_burst() call */
+    struct TxBurst {
+	struct uk_netbuf *bufs[TX_BURST];
+	uint16_t n;
+	uint16_t queue;
+    };
+
+    struct uk_netbuf *packet_to_netbuf(Packet *);
+    bool send_packet(int port, Packet *, TxBurst * = 0);
+    bool send_netbuf(int port, struct uk_netbuf *, TxBurst *);
+    bool transmit(uint16_t queue, struct uk_netbuf *);
+    void transmit_burst(uint16_t queue, struct uk_netbuf **, uint16_t n);
+    void flush(TxBurst *);
+    int send_gso(int port, Packet *, uint16_t mss, TxBurst *);
+
+    /* One input's packets waiting for a TX queue */
+    struct TxClass {
+	MPSCRing<struct uk_netbuf *> ring;
+	struct uk_netbuf *head;	// taken from ring, not sent yet
+	uint32_t quantum;	// 0 for strict priority
+	uint32_t deficit;
+	uint64_t sent;
+	uint64_t bytes;
+	atomic_uint32_t drops;
+    };
+
+    /* Buffers other threads queued for a shared TX queue, or, with
+     * several inputs, all buffers for the queue by class
+     */
+    struct TxStage {
+	TxStage() : classes(0), drr(0) { }
+	MPSCRing<struct uk_netbuf *> ring;
+	TxClass *classes;
+	int drr;		// class whose DRR turn it is
+	Task *task;
+	ToDevice *owner;
+	int thread;
+	uint16_t queue;
+    };
+
+    void drain(TxStage *);
+    int init_classes(TxStage *);
+    bool enqueue(TxStage *, int port, struct uk_netbuf *, int thread);
+    TxClass *pick(TxStage *);
+    bool schedule(TxStage *);
+    static bool drain_task(Task *, void *);
+    static String read_handler(Element *, void *);
+
     Task _task;
 
     int _devid;
+    uint32_t _bufsize;
+    int _gso_anno;
+    bool _hw_tso;
+    bool _trace;
+    uint16_t _ntxq;
+    uint32_t _stage_capacity;
+    int _nprio;
+    Vector<uint32_t> _quantum;
+    Vector<uint32_t> _capacity;
+    Vector<int> _txq_map;
+    Vector<TxStage *> _stages;
+    Vector<uint16_t> _txqs;	// attached, see NetDev::attach_tx()
+    atomic_uint32_t _stage_drops;
+    atomic_uint32_t _tx_errors;
+    NetDev *_nd;
     struct uk_netdev *_dev;
     struct uk_netdev_info _dev_info;
 };